@@ -0,0 +1,425 @@
+#include "mazeGen.h"
+#include "mazeSim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Host program that runs the controller over a fixed, seeded suite of mazes in the batch simulator: every
+ * MAZE_ kind at each of the sizes below, with and without sensor noise. The simulator makes its choices with
+ * the same mazeDecide.h code as the firmware, so a change to the controller shows up here.
+ * Each metric is reported as mean, p50 and p95 over its samples and can be written out as a baseline and
+ * compared against one later. Costs are taken over the robots that succeeded, so getting stuck early never
+ * looks cheap, time counts a failed robot as running out of ticks, and success has its own absolute gate.
+ * Throughput is wall clock and only gates the exit code when a tolerance is given with -T.
+ * usage: mazeBench [-m mazes] [-r robots] [-S seed] [-t tolerance] [-s success drop] [-T throughput tolerance]
+ *                  [-o baseline to write] [-c baseline to compare against]
+ */
+
+static const int sizes[] = {5, 8, 12, 16, 24, 32};
+static const int noises[] = {0, 20};
+static const char *const kind_names[MAZE_KINDS] = {"perfect", "braided", "corridors", "spiral", "dead-ends"};
+#define NUMBER_OF_SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+#define NUMBER_OF_NOISES (int)(sizeof(noises) / sizeof(noises[0]))
+#define NUMBER_OF_CASES (MAZE_KINDS * NUMBER_OF_SIZES * NUMBER_OF_NOISES)
+#define BENCH_MIN_SECONDS 0.02 // each maze is run again until its throughput sample has taken this long
+
+typedef struct BenchMetric
+{
+    const char *name;
+    bool higher_is_better;
+} BenchMetric;
+
+enum
+{
+    METRIC_CELLS_DRIVEN,
+    METRIC_REVISITS,
+    METRIC_TURNS,
+    METRIC_U_TURNS,
+    METRIC_TELEMETRY_BYTES,
+    METRIC_TIME_MS,
+    METRIC_COVERAGE,
+    METRIC_SUCCESS,
+    METRIC_THROUGHPUT,
+    NUMBER_OF_METRICS
+};
+#define METRIC_LAST_COST METRIC_TELEMETRY_BYTES // the metrics up to this one are only sampled from successful robots
+
+static const BenchMetric metrics[NUMBER_OF_METRICS] = {
+    {"cells_driven", false},
+    {"revisits", false},
+    {"turns", false},
+    {"u_turns", false},
+    {"telemetry_bytes", false},  // sent over bluetooth, see SIM_TELEMETRY_
+    {"time_ms", false},          // simulated time until the robot finished, at least max_ticks cells if it failed
+    {"coverage", true},          // share of the cells visited
+    {"success", true},           // see sim_succeeded(), the same test as mazeTuner
+    {"robot_ticks_per_s", true}, // wall clock, one sample per maze
+};
+
+typedef struct BenchResult
+{
+    char name[32]; // case, e.g. perfect-8x8-n20
+    int metric;
+    int samples; // 0 if no robot succeeded for a cost
+    double mean;
+    double p50;
+    double p95;
+} BenchResult;
+
+typedef struct BenchSuite
+{
+    int mazes;  // per case
+    int robots; // per maze
+    uint32_t seed;
+} BenchSuite;
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Fills in the mean, p50 and p95 of the samples, which get sorted, all 0 if there aren't any
+ */
+static void summarise(BenchResult *result, double *samples, int count)
+{
+    result->samples = count;
+    result->mean = result->p50 = result->p95 = 0;
+    if (count == 0)
+    {
+        return;
+    }
+    double total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        total += samples[i];
+    }
+    qsort(samples, count, sizeof(double), compare_doubles);
+    result->mean = total / count;
+    result->p50 = samples[(count * 50 - 1) / 100];
+    result->p95 = samples[(count * 95 - 1) / 100];
+}
+
+/*
+ * Runs one case of the suite, the mazes only depend on the seed so both noise levels see the same ones
+ * @return false if out of memory
+ */
+static bool run_case(const BenchSuite *suite, int kind, int size, int noise, BenchResult *results)
+{
+    int runs = suite->mazes * suite->robots;
+    int counts[NUMBER_OF_METRICS] = {0};
+    double *samples[NUMBER_OF_METRICS];
+    bool ok = true;
+    for (int k = 0; k < NUMBER_OF_METRICS; k++)
+    {
+        samples[k] = malloc(sizeof(double) * runs);
+        ok &= samples[k] != NULL;
+    }
+
+    static uint8_t edges[SIM_MAX_EDGE_BYTES];
+    SimMaze maze;
+    SimConfig config = {noise, size * size * 8, CONTROLLER_PARAMS_DEFAULT};
+    for (int m = 0; m < suite->mazes && ok; m++)
+    {
+        generate_maze(kind, &maze, edges, size, size, sim_seed(suite->seed, m));
+        SimBatch batch;
+        double start = sim_seconds();
+        if (!sim_batch_init(&batch, &maze, &config, suite->robots, sim_seed(suite->seed, m)))
+        {
+            ok = false;
+            break;
+        }
+        sim_batch_run(&batch);
+        double seconds = sim_seconds() - start;
+
+        long run_ticks = 0;
+        for (int i = 0; i < batch.count; i++)
+        {
+            run_ticks += batch.ticks[i];
+        }
+        long ticks = run_ticks;
+        while (seconds < BENCH_MIN_SECONDS && ok) // small mazes are run again so the sample isn't timer noise
+        {
+            SimBatch again;
+            start = sim_seconds();
+            ok = sim_batch_init(&again, &maze, &config, suite->robots, sim_seed(suite->seed, m));
+            if (ok)
+            {
+                sim_batch_run(&again);
+                seconds += sim_seconds() - start;
+                ticks += run_ticks;
+                sim_batch_free(&again);
+            }
+        }
+        if (!ok)
+        {
+            sim_batch_free(&batch);
+            break;
+        }
+        samples[METRIC_THROUGHPUT][counts[METRIC_THROUGHPUT]++] = ticks / seconds;
+
+        double failed_ms = (double)config.max_ticks * (batch.model.drive_ms + batch.model.pause_ms);
+        for (int i = 0; i < batch.count; i++)
+        {
+            bool success = sim_succeeded(&maze, batch.failed[i], batch.food_found[i], batch.water_found[i],
+                                         batch.shelter_found[i]);
+            if (success)
+            {
+                samples[METRIC_CELLS_DRIVEN][counts[METRIC_CELLS_DRIVEN]++] = batch.cells_driven[i];
+                samples[METRIC_REVISITS][counts[METRIC_REVISITS]++] = batch.revisits[i];
+                samples[METRIC_TURNS][counts[METRIC_TURNS]++] = batch.turns[i];
+                samples[METRIC_U_TURNS][counts[METRIC_U_TURNS]++] = batch.u_turns[i];
+                samples[METRIC_TELEMETRY_BYTES][counts[METRIC_TELEMETRY_BYTES]++] = batch.telemetry_bytes[i];
+            }
+            double time_ms = batch.time_ms[i];
+            samples[METRIC_TIME_MS][counts[METRIC_TIME_MS]++] = batch.failed[i] && time_ms < failed_ms ? failed_ms : time_ms;
+            samples[METRIC_COVERAGE][counts[METRIC_COVERAGE]++] = (double)batch.cells_visited[i] / (size * size);
+            samples[METRIC_SUCCESS][counts[METRIC_SUCCESS]++] = success;
+        }
+        sim_batch_free(&batch);
+    }
+
+    for (int k = 0; k < NUMBER_OF_METRICS && ok; k++)
+    {
+        BenchResult *result = &results[k];
+        snprintf(result->name, sizeof(result->name), "%s-%dx%d-n%d", kind_names[kind], size, size, noise);
+        result->metric = k;
+        summarise(result, samples[k], counts[k]);
+    }
+    for (int k = 0; k < NUMBER_OF_METRICS; k++)
+    {
+        free(samples[k]);
+    }
+    return ok;
+}
+
+static void print_results(FILE *file, const BenchSuite *suite, const BenchResult *results, int count)
+{
+    fprintf(file, "# mazeBench mazes %d robots %d seed %u\n", suite->mazes, suite->robots, suite->seed);
+    fprintf(file, "# case metric samples mean p50 p95\n");
+    for (int r = 0; r < count; r++)
+    {
+        fprintf(file, "%s %s %d %.6g %.6g %.6g\n", results[r].name, metrics[results[r].metric].name,
+                results[r].samples, results[r].mean, results[r].p50, results[r].p95);
+    }
+}
+
+/*
+ * Reads a baseline written with -o, the suite it was run with has to match the current one
+ * @return number of results read, -1 if the file can't be read or is from another suite
+ */
+static int load_baseline(const char *path, const BenchSuite *suite, BenchResult *results, int capacity)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    char line[256];
+    int count = 0;
+    bool same_suite = false;
+    while (fgets(line, sizeof(line), file) != NULL && count < capacity)
+    {
+        BenchSuite other;
+        char metric[32];
+        if (sscanf(line, "# mazeBench mazes %d robots %d seed %u", &other.mazes, &other.robots, &other.seed) == 3)
+        {
+            same_suite = other.mazes == suite->mazes && other.robots == suite->robots && other.seed == suite->seed;
+            continue;
+        }
+        BenchResult *result = &results[count];
+        if (line[0] == '#' || sscanf(line, "%31s %31s %d %lf %lf %lf", result->name, metric, &result->samples,
+                                     &result->mean, &result->p50, &result->p95) != 6)
+        {
+            continue;
+        }
+        for (result->metric = 0; result->metric < NUMBER_OF_METRICS; result->metric++)
+        {
+            if (strcmp(metric, metrics[result->metric].name) == 0)
+            {
+                count++;
+                break;
+            }
+        }
+    }
+    fclose(file);
+    return same_suite ? count : -1;
+}
+
+/*
+ * How much worse a value is than the baseline, as a share of the baseline, negative if it is better
+ */
+static double worse_by(double baseline, double value, bool higher_is_better)
+{
+    double change = (value - baseline) / (baseline != 0 ? baseline : 1);
+    return higher_is_better ? -change : change;
+}
+
+/*
+ * Compares every result against the baseline: success by how far its mean dropped, throughput only if
+ * throughput_tolerance isn't negative, the rest by the share the mean, and for costs the p95, got worse.
+ * Costs are left out while either side has no successful robots, the success gate covers those.
+ * @return number of regressions
+ */
+static int compare_results(const BenchResult *baseline, int baseline_count, const BenchResult *results, int count,
+                           double tolerance, double success_drop, double throughput_tolerance)
+{
+    int regressions = 0;
+    for (int r = 0; r < count; r++)
+    {
+        const BenchResult *result = &results[r];
+        const BenchResult *base = NULL;
+        for (int b = 0; b < baseline_count && base == NULL; b++)
+        {
+            if (baseline[b].metric == result->metric && strcmp(baseline[b].name, result->name) == 0)
+            {
+                base = &baseline[b];
+            }
+        }
+        if (base == NULL)
+        {
+            printf("new %s %s\n", result->name, metrics[result->metric].name);
+            continue;
+        }
+
+        const BenchMetric *metric = &metrics[result->metric];
+        if ((result->metric == METRIC_THROUGHPUT && throughput_tolerance < 0) || base->samples == 0 || result->samples == 0)
+        {
+            continue;
+        }
+        double allowed = result->metric == METRIC_THROUGHPUT ? throughput_tolerance : tolerance;
+        double mean_worse = worse_by(base->mean, result->mean, metric->higher_is_better);
+        double p95_worse = 0; // the high tail is only a cost for metrics where lower is better
+        if (result->metric == METRIC_SUCCESS)
+        {
+            allowed = success_drop;
+            mean_worse = base->mean - result->mean; // absolute, a share of a success rate near 0 means nothing
+        }
+        else if (!metric->higher_is_better)
+        {
+            p95_worse = worse_by(base->p95, result->p95, false);
+        }
+        if (mean_worse > allowed || p95_worse > allowed)
+        {
+            printf("REGRESSION %s %s: mean %.6g -> %.6g (%+.1f%%), p95 %.6g -> %.6g (%+.1f%%)\n", result->name,
+                   metric->name, base->mean, result->mean, 100 * mean_worse, base->p95, result->p95, 100 * p95_worse);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    BenchSuite suite = {4, 256, 1};
+    double tolerance = 0.02;
+    double success_drop = 0.01;
+    double throughput_tolerance = -1; // wall clock, depends on the machine and how busy it is, not gated unless set
+    const char *output = NULL;
+    const char *compare = NULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "m:r:S:t:s:T:o:c:")) != -1)
+    {
+        switch (option)
+        {
+        case 'm':
+            suite.mazes = atoi(optarg);
+            break;
+        case 'r':
+            suite.robots = atoi(optarg);
+            break;
+        case 'S':
+            suite.seed = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            tolerance = atof(optarg);
+            break;
+        case 's':
+            success_drop = atof(optarg);
+            break;
+        case 'T':
+            throughput_tolerance = atof(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'c':
+            compare = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m mazes] [-r robots] [-S seed] [-t tolerance] [-s success drop] [-T throughput tolerance] "
+                            "[-o baseline] [-c baseline]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (suite.mazes < 1 || suite.robots < 1)
+    {
+        fprintf(stderr, "mazes and robots have to be at least 1\n");
+        return 1;
+    }
+
+    int count = NUMBER_OF_CASES * NUMBER_OF_METRICS;
+    BenchResult *results = calloc(count, sizeof(BenchResult));
+    BenchResult *baseline = calloc(count, sizeof(BenchResult));
+    if (results == NULL || baseline == NULL)
+    {
+        return 1;
+    }
+    int baseline_count = 0;
+    if (compare != NULL && (baseline_count = load_baseline(compare, &suite, baseline, count)) < 0)
+    {
+        fprintf(stderr, "%s: not a baseline from the same suite (-m, -r and -S have to match)\n", compare);
+        return 1;
+    }
+
+    int r = 0;
+    for (int kind = 0; kind < MAZE_KINDS; kind++)
+    {
+        for (int s = 0; s < NUMBER_OF_SIZES; s++)
+        {
+            for (int n = 0; n < NUMBER_OF_NOISES; n++, r += NUMBER_OF_METRICS)
+            {
+                if (!run_case(&suite, kind, sizes[s], noises[n], &results[r]))
+                {
+                    fprintf(stderr, "out of memory\n");
+                    return 1;
+                }
+            }
+        }
+    }
+    print_results(stdout, &suite, results, count);
+
+    if (output != NULL)
+    {
+        FILE *file = fopen(output, "w");
+        if (file == NULL)
+        {
+            perror(output);
+            return 1;
+        }
+        print_results(file, &suite, results, count);
+        if (fclose(file) != 0)
+        {
+            perror(output);
+            return 1;
+        }
+        printf("baseline written to %s\n", output);
+    }
+
+    int regressions = 0;
+    if (compare != NULL)
+    {
+        regressions = compare_results(baseline, baseline_count, results, count, tolerance, success_drop,
+                                      throughput_tolerance);
+        printf("%d regressions against %s\n", regressions, compare);
+    }
+    free(results);
+    free(baseline);
+    return regressions != 0;
+}
@@ -0,0 +1,258 @@
+#include "mazeCorpus.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t corpus_padding[CORPUS_ALIGN] = {0};
+
+/**
+ * Starts writing a new corpus, the header is filled in by corpus_finish()
+ * @param *writer writer to set up
+ * @param *path file to write, replaced if it is there
+ * @return false if the file couldn't be made
+ */
+bool corpus_create(CorpusWriter *writer, const char *path)
+{
+    CorpusHeader header = {{0}, 0, 0, 0}; // blank until the index is written
+
+    memset(writer, 0, sizeof(CorpusWriter));
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL)
+    {
+        return false;
+    }
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1)
+    {
+        fclose(writer->file);
+        writer->file = NULL;
+        return false;
+    }
+    writer->offset = sizeof(header);
+    return true;
+}
+
+/**
+ * Appends a maze to the corpus
+ * @param *writer writer from corpus_create()
+ * @param *maze maze to store, copied so it can be reused straight away
+ * @param kind MAZE_ kind it was generated as
+ * @return false if the maze doesn't fit the format or the write failed
+ */
+bool corpus_add(CorpusWriter *writer, const SimMaze *maze, int kind)
+{
+    if (maze->rows < 1 || maze->rows > SIM_MAX_SIZE || maze->columns < 1 || maze->columns > SIM_MAX_SIZE)
+    {
+        return false;
+    }
+    if (writer->count == writer->capacity)
+    {
+        uint64_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+        uint64_t *offsets = realloc(writer->offsets, capacity * sizeof(uint64_t));
+        if (offsets == NULL)
+        {
+            return false;
+        }
+        writer->offsets = offsets;
+        writer->capacity = capacity;
+    }
+
+    CorpusRecord record;
+    record.rows = (uint8_t)maze->rows;
+    record.columns = (uint8_t)maze->columns;
+    record.start_row = (uint8_t)maze->start_row;
+    record.start_column = (uint8_t)maze->start_column;
+    record.start_direction = (uint8_t)maze->start_direction;
+    record.kind = (uint8_t)kind;
+    record.food_row = (int8_t)maze->food_row;
+    record.food_column = (int8_t)maze->food_column;
+    record.water_row = (int8_t)maze->water_row;
+    record.water_column = (int8_t)maze->water_column;
+    record.shelter_row = (int8_t)maze->shelter_row;
+    record.shelter_column = (int8_t)maze->shelter_column;
+    record.edge_bytes = (uint16_t)SIM_EDGE_BYTES(maze->rows, maze->columns);
+    record.reserved = 0;
+
+    size_t padding = (CORPUS_ALIGN - record.edge_bytes % CORPUS_ALIGN) % CORPUS_ALIGN;
+    if (fwrite(&record, sizeof(record), 1, writer->file) != 1 ||
+        fwrite(maze->edges, 1, record.edge_bytes, writer->file) != record.edge_bytes ||
+        fwrite(corpus_padding, 1, padding, writer->file) != padding)
+    {
+        return false;
+    }
+    writer->offsets[writer->count++] = writer->offset;
+    writer->offset += sizeof(record) + record.edge_bytes + padding;
+    return true;
+}
+
+/**
+ * Writes the index and the header and closes the file, the writer can't be used after this
+ * @return false if any of the writes failed
+ */
+bool corpus_finish(CorpusWriter *writer)
+{
+    CorpusHeader header;
+    memcpy(header.magic, CORPUS_MAGIC, sizeof(header.magic));
+    header.version = CORPUS_VERSION;
+    header.count = writer->count;
+    header.index_offset = writer->offset;
+
+    bool ok = fwrite(writer->offsets, sizeof(uint64_t), writer->count, writer->file) == writer->count &&
+              fseek(writer->file, 0, SEEK_SET) == 0 &&
+              fwrite(&header, sizeof(header), 1, writer->file) == 1;
+    ok &= fclose(writer->file) == 0;
+    free(writer->offsets);
+    memset(writer, 0, sizeof(CorpusWriter));
+    return ok;
+}
+
+/**
+ * Gives up on a corpus, closing the file without a header and deleting it, the writer can't be used after this
+ * @param *writer writer from corpus_create()
+ * @param *path file it was created with
+ */
+void corpus_abort(CorpusWriter *writer, const char *path)
+{
+    fclose(writer->file);
+    remove(path);
+    free(writer->offsets);
+    memset(writer, 0, sizeof(CorpusWriter));
+}
+
+/**
+ * Maps a corpus into memory and checks its header and index
+ * @param *corpus corpus to set up
+ * @param *path file written by corpus_finish()
+ * @return false if the file can't be read or isn't a finished corpus
+ */
+bool corpus_open(MazeCorpus *corpus, const char *path)
+{
+    memset(corpus, 0, sizeof(MazeCorpus));
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || (uint64_t)info.st_size < sizeof(CorpusHeader))
+    {
+        close(file);
+        return false;
+    }
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file); // the mapping keeps the file open
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    corpus->data = data;
+    corpus->size = (size_t)info.st_size;
+
+    const CorpusHeader *header = data;
+    if (memcmp(header->magic, CORPUS_MAGIC, sizeof(header->magic)) != 0 || header->version != CORPUS_VERSION ||
+        header->index_offset % CORPUS_ALIGN != 0 || header->index_offset < sizeof(CorpusHeader) ||
+        header->index_offset > corpus->size ||
+        header->count > (corpus->size - header->index_offset) / sizeof(uint64_t))
+    {
+        corpus_close(corpus);
+        return false;
+    }
+    corpus->count = header->count;
+    corpus->index = (const uint64_t *)(corpus->data + header->index_offset);
+    posix_madvise((void *)corpus->data, corpus->size, POSIX_MADV_RANDOM); // mazes are read in any order
+    return true;
+}
+
+/*
+ * Finds a record and checks it lies inside the file and describes a maze the simulator can run
+ */
+static const CorpusRecord *corpus_record(const MazeCorpus *corpus, uint64_t index)
+{
+    if (index >= corpus->count)
+    {
+        return NULL;
+    }
+    uint64_t offset = corpus->index[index];
+    uint64_t end = (uint64_t)((const uint8_t *)corpus->index - corpus->data);
+    if (offset < sizeof(CorpusHeader) || offset % CORPUS_ALIGN != 0 || offset > end - sizeof(CorpusRecord))
+    {
+        return NULL;
+    }
+
+    const CorpusRecord *record = (const CorpusRecord *)(corpus->data + offset);
+    int rows = record->rows;
+    int columns = record->columns;
+    if (rows < 1 || rows > SIM_MAX_SIZE || columns < 1 || columns > SIM_MAX_SIZE ||
+        record->edge_bytes != SIM_EDGE_BYTES(rows, columns) ||
+        record->edge_bytes > end - offset - sizeof(CorpusRecord) ||
+        record->start_row >= rows || record->start_column >= columns || record->start_direction > 3)
+    {
+        return NULL;
+    }
+
+    const int8_t points[3][2] = {{record->food_row, record->food_column},
+                                 {record->water_row, record->water_column},
+                                 {record->shelter_row, record->shelter_column}};
+    for (int i = 0; i < 3; i++)
+    {
+        bool missing = points[i][0] == -1 && points[i][1] == -1;
+        bool inside = points[i][0] >= 0 && points[i][0] < rows && points[i][1] >= 0 && points[i][1] < columns;
+        if (!missing && !inside)
+        {
+            return NULL;
+        }
+    }
+    return record;
+}
+
+/**
+ * Gives a view of one maze in the corpus, the walls aren't copied and stay valid until corpus_close()
+ * @param *corpus corpus from corpus_open()
+ * @param index maze to look at, from 0 to corpus->count - 1
+ * @param *maze filled in with the maze
+ * @return false if the index is out of range or the record is broken
+ */
+bool corpus_maze(const MazeCorpus *corpus, uint64_t index, SimMaze *maze)
+{
+    const CorpusRecord *record = corpus_record(corpus, index);
+    if (record == NULL)
+    {
+        return false;
+    }
+    maze->rows = record->rows;
+    maze->columns = record->columns;
+    maze->start_row = record->start_row;
+    maze->start_column = record->start_column;
+    maze->start_direction = record->start_direction;
+    maze->food_row = record->food_row;
+    maze->food_column = record->food_column;
+    maze->water_row = record->water_row;
+    maze->water_column = record->water_column;
+    maze->shelter_row = record->shelter_row;
+    maze->shelter_column = record->shelter_column;
+    maze->edges = (const uint8_t *)(record + 1);
+    return true;
+}
+
+/**
+ * @return the MAZE_ kind a maze was generated as, -1 if the index is out of range or the record is broken
+ */
+int corpus_kind(const MazeCorpus *corpus, uint64_t index)
+{
+    const CorpusRecord *record = corpus_record(corpus, index);
+    return record == NULL ? -1 : record->kind;
+}
+
+/**
+ * Unmaps the corpus, any maze views from it can't be used after this
+ */
+void corpus_close(MazeCorpus *corpus)
+{
+    if (corpus->data != NULL)
+    {
+        munmap((void *)corpus->data, corpus->size);
+    }
+    memset(corpus, 0, sizeof(MazeCorpus));
+}
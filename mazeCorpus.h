@@ -0,0 +1,88 @@
+#ifndef MAZE_CORPUS
+#define MAZE_CORPUS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mazeSim.h"
+
+/*
+ * A maze corpus is one file holding many mazes so that big runs don't have to generate them again.
+ *
+ *   CorpusHeader
+ *   record 0: CorpusRecord, edge_bytes of packed wall bits (see sim_edge_index()), padded to 8 bytes
+ *   record 1 ...
+ *   index: count uint64 file offsets, one for each record
+ *
+ * Numbers are in the byte order of the machine that wrote the file, the index is read straight out of the
+ * mapping. A file from a machine of the other byte order reads back the wrong version and is refused by
+ * corpus_open(). The header is written last, so a file that was never finished has no index and is refused
+ * as well.
+ */
+
+#define CORPUS_MAGIC "MZC1"
+#define CORPUS_VERSION 1
+#define CORPUS_ALIGN 8 // records and the index start on a multiple of this
+
+typedef struct CorpusHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t count;        // number of mazes
+    uint64_t index_offset; // where the record offsets start
+} CorpusHeader;
+
+typedef struct CorpusRecord
+{
+    uint8_t rows;
+    uint8_t columns;
+    uint8_t start_row;
+    uint8_t start_column;
+    uint8_t start_direction;
+    uint8_t kind; // MAZE_ kind it was generated as, see mazeGen.h
+    int8_t food_row; // -1 if there isn't any food
+    int8_t food_column;
+    int8_t water_row;
+    int8_t water_column;
+    int8_t shelter_row;
+    int8_t shelter_column;
+    uint16_t edge_bytes; // SIM_EDGE_BYTES(rows, columns)
+    uint16_t reserved;
+} CorpusRecord;
+
+/*
+ * Writes a corpus one maze at a time, only the offsets are kept in memory
+ */
+typedef struct CorpusWriter
+{
+    FILE *file;
+    uint64_t count;
+    uint64_t offset; // where the next record goes
+    uint64_t *offsets;
+    uint64_t capacity;
+} CorpusWriter;
+
+/*
+ * A corpus mapped into memory, mazes are handed out as views straight into the mapping
+ */
+typedef struct MazeCorpus
+{
+    const uint8_t *data;
+    size_t size;
+    uint64_t count;
+    const uint64_t *index;
+} MazeCorpus;
+
+bool corpus_create(CorpusWriter *writer, const char *path);
+bool corpus_add(CorpusWriter *writer, const SimMaze *maze, int kind);
+bool corpus_finish(CorpusWriter *writer);
+void corpus_abort(CorpusWriter *writer, const char *path);
+
+bool corpus_open(MazeCorpus *corpus, const char *path);
+bool corpus_maze(const MazeCorpus *corpus, uint64_t index, SimMaze *maze);
+int corpus_kind(const MazeCorpus *corpus, uint64_t index);
+void corpus_close(MazeCorpus *corpus);
+
+#endif
@@ -0,0 +1,86 @@
+#include "mazeCorpus.h"
+#include "mazeGen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Host program that writes a corpus of generated mazes, going round every MAZE_ kind with random sizes,
+ * and reads it back through the mapping to check it.
+ * usage: mazeCorpusGen file [count] [min size] [max size] [seed]
+ */
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s file [count] [min size] [max size] [seed]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    long count = argc > 2 ? atol(argv[2]) : 10000;
+    int min_size = argc > 3 ? atoi(argv[3]) : 5;
+    int max_size = argc > 4 ? atoi(argv[4]) : SIM_MAX_SIZE;
+    uint32_t seed = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 1;
+
+    if (count < 1 || min_size < 2 || max_size > SIM_MAX_SIZE || min_size > max_size)
+    {
+        fprintf(stderr, "sizes go from 2 to %d\n", SIM_MAX_SIZE);
+        return 1;
+    }
+
+    static uint8_t edges[SIM_MAX_EDGE_BYTES];
+    SimMaze maze;
+    CorpusWriter writer;
+    if (!corpus_create(&writer, path))
+    {
+        perror(path);
+        return 1;
+    }
+    for (long i = 0; i < count; i++)
+    {
+        uint32_t maze_seed = sim_seed(seed, (int)i);
+        int size = min_size + (int)(maze_seed % (uint32_t)(max_size - min_size + 1));
+        generate_maze((int)(i % MAZE_KINDS), &maze, edges, size, size, maze_seed);
+        if (!corpus_add(&writer, &maze, (int)(i % MAZE_KINDS)))
+        {
+            fprintf(stderr, "%s: write failed\n", path);
+            corpus_abort(&writer, path);
+            return 1;
+        }
+    }
+    if (!corpus_finish(&writer))
+    {
+        fprintf(stderr, "%s: write failed\n", path);
+        remove(path); // the header may have gone out over a missing index
+        return 1;
+    }
+
+    MazeCorpus corpus;
+    if (!corpus_open(&corpus, path))
+    {
+        fprintf(stderr, "%s: not a maze corpus\n", path);
+        return 1;
+    }
+    long mismatches = 0;
+    for (uint64_t i = 0; i < corpus.count; i++)
+    {
+        SimMaze view;
+        uint32_t maze_seed = sim_seed(seed, (int)i);
+        int size = min_size + (int)(maze_seed % (uint32_t)(max_size - min_size + 1));
+        generate_maze((int)(i % MAZE_KINDS), &maze, edges, size, size, maze_seed);
+        if (!corpus_maze(&corpus, i, &view) || corpus_kind(&corpus, i) != (int)(i % MAZE_KINDS) ||
+            view.rows != maze.rows || view.columns != maze.columns || view.food_row != maze.food_row ||
+            view.food_column != maze.food_column || view.water_row != maze.water_row ||
+            view.water_column != maze.water_column || view.shelter_row != maze.shelter_row ||
+            view.shelter_column != maze.shelter_column ||
+            memcmp(view.edges, maze.edges, SIM_EDGE_BYTES(size, size)) != 0)
+        {
+            mismatches++;
+        }
+    }
+    printf("%s: %llu mazes, %zu bytes, %ld differ on reading back\n", path, (unsigned long long)corpus.count,
+           corpus.size, mismatches);
+    corpus_close(&corpus);
+    return mismatches != 0;
+}
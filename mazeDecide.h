@@ -0,0 +1,81 @@
+#ifndef MAZE_DECIDE
+#define MAZE_DECIDE
+
+/*
+ * The choices the controller makes in a cell, kept apart from the robot API so that the firmware
+ * (mazeSolver.c) and the simulator (mazeSim.c) both run this code rather than copies of it. Everything
+ * here takes and gives ints and uses & and | rather than && and ||, so the batch simulator can inline it into
+ * its branch free loops and still vectorise them.
+ */
+
+#define DECIDE_STRAIGHT 0 // turn types, the same as set_direction()
+#define DECIDE_RIGHT 1
+#define DECIDE_LEFT 2
+#define DECIDE_AROUND 3
+
+#define DECIDE_START_REAR 30 // rear reading under which the robot turns around before driving
+#define DECIDE_START_SIDE 50 // side reading over which the robot turns away before driving
+
+/**
+ * Whether an ir reading is a wall, the test set_walls() makes on every side
+ * @param reading ir reading
+ * @param threshold params.wall_threshold
+ */
+static inline int decide_wall(int reading, int threshold)
+{
+    return reading > threshold;
+}
+
+/**
+ * Whether a cell is an intersection, where backtracking ends, see set_intersection()
+ * @param front, right, rear, left walls of the cell
+ */
+static inline int decide_intersection(int front, int right, int rear, int left)
+{
+    return !front + !right + !rear + !left > 2;
+}
+
+/**
+ * Chooses the turn wall_based_movement() makes: around at a dead end, otherwise left if it is open and right if
+ * it isn't, as long as the cell that way is unvisited or the robot is backtracking
+ * @param front_wall, left_wall, right_wall walls of the cell relative to the robot
+ * @param left_visited, right_visited the cell to that side has been visited, only looked at if it is open
+ * @param backtrack backtracking flag
+ * @return DECIDE_ turn type
+ */
+static inline int decide_turn(int front_wall, int left_wall, int right_wall, int left_visited, int right_visited,
+                              int backtrack)
+{
+    int dead_end = front_wall & left_wall & right_wall;
+    int turn_left = (!dead_end) & (!left_wall) & ((!left_visited) | backtrack);
+    int turn_right = (!dead_end) & left_wall & (!right_wall) & ((!right_visited) | backtrack);
+    return dead_end ? DECIDE_AROUND : turn_left ? DECIDE_LEFT : turn_right ? DECIDE_RIGHT : DECIDE_STRAIGHT;
+}
+
+/**
+ * Gives the backtracking flag after the turn from decide_turn(), turning around at a dead end starts backtracking
+ * @param turn DECIDE_ turn type
+ * @param backtrack backtracking flag before the turn
+ */
+static inline int decide_backtrack(int turn, int backtrack)
+{
+    return backtrack | (turn == DECIDE_AROUND);
+}
+
+/**
+ * Chooses the turn stop_when_line_hit() makes before the motors start, when the robot is left facing a wall:
+ * around if nothing is behind it, otherwise away from a side wall
+ * @param front, rear, left, right ir readings
+ * @param threshold params.facing_wall_threshold
+ * @return DECIDE_ turn type
+ */
+static inline int decide_departure(int front, int rear, int left, int right, int threshold)
+{
+    int facing = front > threshold;
+    int around = facing & (rear < DECIDE_START_REAR);
+    int away_right = facing & (!around) & (left > DECIDE_START_SIDE);
+    int away_left = facing & (!around) & (!away_right) & (right > DECIDE_START_SIDE);
+    return around ? DECIDE_AROUND : away_right ? DECIDE_RIGHT : away_left ? DECIDE_LEFT : DECIDE_STRAIGHT;
+}
+
+#endif
@@ -0,0 +1,437 @@
+#include "mazeGen.h"
+#include <string.h>
+
+static bool gen_inside(const SimMaze *maze, int row, int column)
+{
+    return row >= 0 && row < maze->rows && column >= 0 && column < maze->columns;
+}
+
+/*
+ * Opens the wall between a cell and its neighbour in a direction
+ */
+static void gen_carve(SimMaze *maze, uint8_t *edges, int cell, int direction)
+{
+    sim_set_wall(edges, maze->rows, maze->columns, cell / maze->columns, cell % maze->columns, direction, false);
+}
+
+/*
+ * Fills every wall in and sets up the maze fields, the robot starts in the corner facing north
+ */
+static void gen_begin(SimMaze *maze, uint8_t *edges, int rows, int columns)
+{
+    memset(edges, 0xff, SIM_EDGE_BYTES(rows, columns));
+    maze->rows = rows;
+    maze->columns = columns;
+    maze->start_row = 0;
+    maze->start_column = 0;
+    maze->start_direction = 0;
+    maze->food_row = maze->food_column = -1;
+    maze->water_row = maze->water_column = -1;
+    maze->shelter_row = maze->shelter_column = -1;
+    maze->edges = edges;
+}
+
+static bool gen_is_point(const SimMaze *maze, int row, int column)
+{
+    return (row == maze->start_row && column == maze->start_column) || (row == maze->food_row && column == maze->food_column) ||
+           (row == maze->water_row && column == maze->water_column) || (row == maze->shelter_row && column == maze->shelter_column);
+}
+
+static bool gen_backs_out(const SimMaze *maze, int cell)
+{
+    return cell == maze->food_row * maze->columns + maze->food_column ||
+           cell == maze->water_row * maze->columns + maze->water_column;
+}
+
+/*
+ * Finds the cells the robot can reach from the start without going through food or water, which it backs out
+ * of, and marks the ones among them that every way to some other cell goes through (articulation points)
+ */
+static void gen_cut_cells(const SimMaze *maze, bool *reached, bool *cut)
+{
+    int order[SIM_MAX_CELLS]; // when the depth first search got to each cell
+    int low[SIM_MAX_CELLS];   // earliest cell reachable from its subtree without going through it
+    int parent[SIM_MAX_CELLS];
+    int next_direction[SIM_MAX_CELLS];
+    int stack[SIM_MAX_CELLS];
+    int counter = 0;
+    int top = 0;
+    int root = maze->start_row * maze->columns + maze->start_column;
+
+    for (int cell = 0; cell < maze->rows * maze->columns; cell++)
+    {
+        reached[cell] = false;
+        cut[cell] = false;
+    }
+    reached[root] = true;
+    order[root] = low[root] = counter++;
+    parent[root] = -1;
+    next_direction[root] = 0;
+    stack[top++] = root;
+    while (top > 0)
+    {
+        int cell = stack[top - 1];
+        if (next_direction[cell] < 4)
+        {
+            int d = next_direction[cell]++;
+            int next_row = cell / maze->columns + sim_step_row(d);
+            int next_column = cell % maze->columns + sim_step_column(d);
+            int next = next_row * maze->columns + next_column;
+            if (!gen_inside(maze, next_row, next_column) || sim_has_wall(maze, cell / maze->columns, cell % maze->columns, d) ||
+                gen_backs_out(maze, next))
+            {
+                continue;
+            }
+            if (!reached[next])
+            {
+                reached[next] = true;
+                order[next] = low[next] = counter++;
+                parent[next] = cell;
+                next_direction[next] = 0;
+                stack[top++] = next;
+            }
+            else if (next != parent[cell] && order[next] < low[cell])
+            {
+                low[cell] = order[next];
+            }
+            continue;
+        }
+        top--;
+        int above = parent[cell];
+        if (above >= 0)
+        {
+            low[above] = low[cell] < low[above] ? low[cell] : low[above];
+            if (low[cell] >= order[above] && above != root)
+            {
+                cut[above] = true;
+            }
+        }
+    }
+}
+
+/*
+ * Whether a food or water cell opens onto a reachable cell other than the one about to be taken
+ */
+static bool gen_opens_onto(const SimMaze *maze, int point_row, int point_column, const bool *reached, int taken)
+{
+    if (point_row < 0)
+    {
+        return true;
+    }
+    for (int d = 0; d < 4; d++)
+    {
+        int row = point_row + sim_step_row(d);
+        int column = point_column + sim_step_column(d);
+        int cell = row * maze->columns + column;
+        if (gen_inside(maze, row, column) && !sim_has_wall(maze, point_row, point_column, d) && reached[cell] && cell != taken)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Picks a random cell that isn't the start or already used by another point of interest. The robot backs out
+ * of food and water, so they only go where every other cell can still be reached without driving through them,
+ * like the dead ends of a perfect maze, and are left out (-1) if there is nowhere like that.
+ */
+static void gen_place_point(SimMaze *maze, uint32_t *state, int *row, int *column, bool backed_out)
+{
+    int cell_count = maze->rows * maze->columns;
+    int candidates[SIM_MAX_CELLS];
+    int number_of_candidates = 0;
+    bool reached[SIM_MAX_CELLS];
+    bool cut[SIM_MAX_CELLS];
+
+    gen_cut_cells(maze, reached, cut);
+    for (int cell = 0; cell < cell_count; cell++)
+    {
+        int r = cell / maze->columns;
+        int c = cell % maze->columns;
+        if (gen_is_point(maze, r, c))
+        {
+            continue;
+        }
+        if (!backed_out || (reached[cell] && !cut[cell] && gen_opens_onto(maze, maze->food_row, maze->food_column, reached, cell) &&
+                            gen_opens_onto(maze, maze->water_row, maze->water_column, reached, cell)))
+        {
+            candidates[number_of_candidates++] = cell;
+        }
+    }
+    if (number_of_candidates == 0)
+    {
+        if (!backed_out && cell_count < 4) // too small for every point to get its own cell
+        {
+            *row = maze->start_row;
+            *column = maze->start_column;
+        }
+        return;
+    }
+    int cell = candidates[sim_random(state) % (uint32_t)number_of_candidates];
+    *row = cell / maze->columns;
+    *column = cell % maze->columns;
+}
+
+static void gen_place_points(SimMaze *maze, uint32_t *state)
+{
+    gen_place_point(maze, state, &maze->food_row, &maze->food_column, true);
+    gen_place_point(maze, state, &maze->water_row, &maze->water_column, true);
+    gen_place_point(maze, state, &maze->shelter_row, &maze->shelter_column, false);
+}
+
+/*
+ * Recursive backtracker, with straight_bias out of 8 it keeps going the same way when it can
+ */
+static void gen_backtracker(SimMaze *maze, uint8_t *edges, uint32_t *state, int straight_bias)
+{
+    int stack[SIM_MAX_CELLS];
+    int entered[SIM_MAX_CELLS]; // direction the cell was carved into from
+    bool carved[SIM_MAX_CELLS] = {false};
+    int top = 0;
+
+    stack[top++] = 0;
+    entered[0] = -1;
+    carved[0] = true;
+
+    while (top > 0)
+    {
+        int cell = stack[top - 1];
+        int row = cell / maze->columns;
+        int column = cell % maze->columns;
+        int options[4];
+        int number_of_options = 0;
+        bool can_go_straight = false;
+
+        for (int d = 0; d < 4; d++)
+        {
+            int next_row = row + sim_step_row(d);
+            int next_column = column + sim_step_column(d);
+            if (gen_inside(maze, next_row, next_column) && !carved[next_row * maze->columns + next_column])
+            {
+                options[number_of_options++] = d;
+                can_go_straight |= d == entered[cell];
+            }
+        }
+
+        if (number_of_options == 0) // dead end, go back
+        {
+            top--;
+            continue;
+        }
+
+        int d;
+        if (can_go_straight && straight_bias > 0 && (int)(sim_random(state) % 8) < straight_bias)
+        {
+            d = entered[cell];
+        }
+        else
+        {
+            d = options[sim_random(state) % (uint32_t)number_of_options];
+        }
+        int next = (row + sim_step_row(d)) * maze->columns + column + sim_step_column(d);
+        gen_carve(maze, edges, cell, d);
+        carved[next] = true;
+        entered[next] = d;
+        stack[top++] = next;
+    }
+}
+
+/**
+ * This function generates a perfect maze (one path between any two cells) with a recursive backtracker,
+ * the robot starts in the corner facing north and the food, water and shelter are put in random cells, food and
+ * water only where every other cell can still be reached (see gen_place_point())
+ * @param *maze maze to fill in, its edges point at *edges
+ * @param *edges room for SIM_EDGE_BYTES(rows, columns) wall bits
+ * @param rows, columns size of the maze, up to SIM_MAX_SIZE
+ * @param seed generator seed, the same seed always gives the same maze
+ */
+void generate_perfect_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed)
+{
+    uint32_t state = sim_seed(seed, 0);
+    gen_begin(maze, edges, rows, columns);
+    gen_backtracker(maze, edges, &state, 0);
+    gen_place_points(maze, &state);
+}
+
+/**
+ * Generates a perfect maze and then knocks a wall out of every dead end, so there are loops everywhere
+ * and no dead ends, same params as generate_perfect_maze()
+ */
+void generate_braided_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed)
+{
+    uint32_t state = sim_seed(seed, 0);
+    gen_begin(maze, edges, rows, columns);
+    gen_backtracker(maze, edges, &state, 0);
+
+    for (int cell = 0; cell < rows * columns; cell++)
+    {
+        int row = cell / columns;
+        int column = cell % columns;
+        int options[4];
+        int number_of_options = 0;
+        int walls = 0;
+
+        for (int d = 0; d < 4; d++)
+        {
+            if (!sim_has_wall(maze, row, column, d))
+            {
+                continue;
+            }
+            walls++;
+            if (gen_inside(maze, row + sim_step_row(d), column + sim_step_column(d)))
+            {
+                options[number_of_options++] = d;
+            }
+        }
+        if (walls == 3 && number_of_options > 0)
+        {
+            gen_carve(maze, edges, cell, options[sim_random(&state) % (uint32_t)number_of_options]);
+        }
+    }
+    gen_place_points(maze, &state);
+}
+
+/**
+ * Generates a perfect maze that keeps going straight whenever it can, giving long corridors with few
+ * turns, same params as generate_perfect_maze()
+ */
+void generate_corridor_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed)
+{
+    uint32_t state = sim_seed(seed, 0);
+    gen_begin(maze, edges, rows, columns);
+    gen_backtracker(maze, edges, &state, 7);
+    gen_place_points(maze, &state);
+}
+
+/**
+ * Generates a single path that spirals from the start corner into the middle, so every cell is on the way
+ * and the robot has to drive the whole maze. The end of the path is the only cell food can go without cutting
+ * the rest off, so there is no water, same params as generate_perfect_maze()
+ */
+void generate_spiral_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed)
+{
+    uint32_t state = sim_seed(seed, 0);
+    gen_begin(maze, edges, rows, columns);
+
+    int top = 0;
+    int bottom = rows - 1;
+    int left = 0;
+    int right = columns - 1;
+    int row = 0;
+    int column = 0;
+    int direction = 0;
+    int carved = 1;
+
+    while (carved < rows * columns)
+    {
+        int next_row = row + sim_step_row(direction);
+        int next_column = column + sim_step_column(direction);
+        if (next_row < top || next_row > bottom || next_column < left || next_column > right)
+        {
+            switch (direction) // finished a side, the ring gets smaller behind us
+            {
+            case 0:
+                top++;
+                break;
+            case 1:
+                right--;
+                break;
+            case 2:
+                bottom--;
+                break;
+            default:
+                left++;
+                break;
+            }
+            direction = (direction + 1) % 4;
+            continue;
+        }
+        gen_carve(maze, edges, row * columns + column, direction);
+        row = next_row;
+        column = next_column;
+        carved++;
+    }
+    gen_place_points(maze, &state);
+}
+
+/**
+ * Generates a perfect maze with randomised Prim's algorithm, which grows lots of short dead ends,
+ * same params as generate_perfect_maze()
+ */
+void generate_dead_end_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed)
+{
+    uint32_t state = sim_seed(seed, 0);
+    int frontier[SIM_MAX_CELLS];
+    bool carved[SIM_MAX_CELLS] = {false};
+    bool listed[SIM_MAX_CELLS] = {false};
+    int number_in_frontier = 0;
+
+    gen_begin(maze, edges, rows, columns);
+    carved[0] = true;
+    for (int cell = 0; cell >= 0;)
+    {
+        for (int d = 0; d < 4; d++) // add the new cell's neighbours to the frontier
+        {
+            int next_row = cell / columns + sim_step_row(d);
+            int next_column = cell % columns + sim_step_column(d);
+            int next = next_row * columns + next_column;
+            if (gen_inside(maze, next_row, next_column) && !carved[next] && !listed[next])
+            {
+                listed[next] = true;
+                frontier[number_in_frontier++] = next;
+            }
+        }
+        if (number_in_frontier == 0)
+        {
+            break;
+        }
+
+        int pick = (int)(sim_random(&state) % (uint32_t)number_in_frontier);
+        cell = frontier[pick];
+        frontier[pick] = frontier[--number_in_frontier];
+
+        int options[4];
+        int number_of_options = 0;
+        for (int d = 0; d < 4; d++) // join it to a random carved neighbour
+        {
+            int next_row = cell / columns + sim_step_row(d);
+            int next_column = cell % columns + sim_step_column(d);
+            if (gen_inside(maze, next_row, next_column) && carved[next_row * columns + next_column])
+            {
+                options[number_of_options++] = d;
+            }
+        }
+        gen_carve(maze, edges, cell, options[sim_random(&state) % (uint32_t)number_of_options]);
+        carved[cell] = true;
+    }
+    gen_place_points(maze, &state);
+}
+
+/**
+ * Generates a maze of one of the MAZE_ kinds
+ * @return false if the kind isn't known
+ */
+bool generate_maze(int kind, SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed)
+{
+    switch (kind)
+    {
+    case MAZE_PERFECT:
+        generate_perfect_maze(maze, edges, rows, columns, seed);
+        return true;
+    case MAZE_BRAIDED:
+        generate_braided_maze(maze, edges, rows, columns, seed);
+        return true;
+    case MAZE_CORRIDORS:
+        generate_corridor_maze(maze, edges, rows, columns, seed);
+        return true;
+    case MAZE_SPIRAL:
+        generate_spiral_maze(maze, edges, rows, columns, seed);
+        return true;
+    case MAZE_DEAD_ENDS:
+        generate_dead_end_maze(maze, edges, rows, columns, seed);
+        return true;
+    default:
+        return false;
+    }
+}
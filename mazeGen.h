@@ -0,0 +1,23 @@
+#ifndef MAZE_GEN
+#define MAZE_GEN
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mazeSim.h"
+
+#define MAZE_PERFECT 0   // one path between any two cells
+#define MAZE_BRAIDED 1   // loops and no dead ends
+#define MAZE_CORRIDORS 2 // long straight corridors
+#define MAZE_SPIRAL 3    // one path spiralling into the middle
+#define MAZE_DEAD_ENDS 4 // lots of short dead ends
+#define MAZE_KINDS 5
+
+void generate_perfect_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed);
+void generate_braided_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed);
+void generate_corridor_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed);
+void generate_spiral_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed);
+void generate_dead_end_maze(SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed);
+bool generate_maze(int kind, SimMaze *maze, uint8_t *edges, int rows, int columns, uint32_t seed);
+
+#endif
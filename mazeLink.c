@@ -0,0 +1,208 @@
+#include "mazeLink.h"
+#include "mazeSim.h"
+
+static char link_field(int value)
+{
+    return (char)('0' + value);
+}
+
+/*
+ * Reads a one character field, -1 if it is out of range
+ */
+static int link_value(char field, int limit)
+{
+    int value = field - '0';
+    return value >= 0 && value < limit ? value : -1;
+}
+
+/**
+ * Writes an observation frame
+ * @param *frame room for LINK_FRAME_BYTES
+ * @return length of the frame
+ */
+int link_encode_observation(char *frame, const LinkObservation *observation)
+{
+    frame[0] = 'O';
+    frame[1] = link_field(observation->sequence % LINK_HISTORY);
+    frame[2] = link_field(observation->row);
+    frame[3] = link_field(observation->column);
+    frame[4] = link_field(observation->walls);
+    frame[5] = link_field(observation->direction);
+    frame[6] = '\n';
+    return 7;
+}
+
+bool link_decode_observation(const char *frame, int length, LinkObservation *observation)
+{
+    if (length != 7 || frame[0] != 'O' || frame[6] != '\n')
+    {
+        return false;
+    }
+    observation->sequence = link_value(frame[1], LINK_HISTORY);
+    observation->row = link_value(frame[2], 64);
+    observation->column = link_value(frame[3], 64);
+    observation->walls = link_value(frame[4], 64);
+    observation->direction = link_value(frame[5], 4);
+    return observation->sequence >= 0 && observation->row >= 0 && observation->column >= 0 &&
+           observation->walls >= 0 && observation->direction >= 0;
+}
+
+/**
+ * Writes a plan frame
+ * @param *frame room for LINK_FRAME_BYTES
+ * @return length of the frame
+ */
+int link_encode_plan(char *frame, const LinkPlan *plan)
+{
+    int length = 0;
+    frame[length++] = 'P';
+    frame[length++] = link_field(plan->sequence % LINK_HISTORY);
+    frame[length++] = link_field(plan->depth);
+    for (int i = 0; i < plan->depth; i++)
+    {
+        frame[length++] = link_field(plan->moves[i]);
+    }
+    frame[length++] = '\n';
+    return length;
+}
+
+bool link_decode_plan(const char *frame, int length, LinkPlan *plan)
+{
+    if (length < 4 || frame[0] != 'P' || frame[length - 1] != '\n')
+    {
+        return false;
+    }
+    plan->sequence = link_value(frame[1], LINK_HISTORY);
+    plan->depth = link_value(frame[2], LINK_MAX_DEPTH + 1);
+    if (plan->sequence < 0 || plan->depth < 0 || length != plan->depth + 4)
+    {
+        return false;
+    }
+    for (int i = 0; i < plan->depth; i++)
+    {
+        plan->moves[i] = link_value(frame[3 + i], 4);
+        if (plan->moves[i] < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads what has arrived on the link up to the end of the next frame, bytes that don't fit a frame are dropped
+ * @param *reader reader to gather bytes in, a whole frame is left in reader->frame
+ * @param *link link to read from
+ * @return length of the frame, 0 if there isn't a whole one yet
+ */
+int link_read_frame(LinkReader *reader, const PlanLink *link)
+{
+    char byte;
+    while (link->receive(link->context, &byte, 1) == 1)
+    {
+        if (reader->length == LINK_FRAME_BYTES) // too long for a frame, start again
+        {
+            reader->length = 0;
+        }
+        reader->frame[reader->length++] = byte;
+        if (byte == '\n')
+        {
+            int length = reader->length;
+            reader->length = 0;
+            return length;
+        }
+    }
+    return 0;
+}
+
+void link_robot_init(LinkRobot *robot)
+{
+    robot->sequence = 0;
+    robot->have_plan = false;
+    robot->plan_sequence = -1;
+    robot->explored = false;
+    robot->reader.length = 0;
+}
+
+/**
+ * Sends what the robot saw in a cell to the planner
+ * @param *robot robot side of the link
+ * @param *link link to the planner
+ * @param *observation walls of the cell, the sequence number is filled in
+ * @param decision_row, decision_column cell the robot is in now, the last one if it backed out of food or water
+ */
+void link_robot_observe(LinkRobot *robot, const PlanLink *link, LinkObservation *observation, int decision_row, int decision_column)
+{
+    char frame[LINK_FRAME_BYTES];
+    observation->sequence = robot->sequence;
+    robot->decision_row[robot->sequence % LINK_HISTORY] = decision_row;
+    robot->decision_column[robot->sequence % LINK_HISTORY] = decision_column;
+    robot->sequence++;
+    link->send(link->context, frame, link_encode_observation(frame, observation));
+}
+
+/**
+ * Takes in every plan that has arrived, keeping the newest one with moves. The wrapped sequence number of a plan
+ * is taken as the latest observation that wraps to it, plans older than the one kept are dropped
+ */
+void link_robot_poll(LinkRobot *robot, const PlanLink *link)
+{
+    int latest = robot->sequence - 1;
+    int length;
+    while ((length = link_read_frame(&robot->reader, link)) > 0)
+    {
+        LinkPlan plan;
+        if (!link_decode_plan(robot->reader.frame, length, &plan))
+        {
+            continue;
+        }
+        int sequence = latest - ((latest - plan.sequence) % LINK_HISTORY + LINK_HISTORY) % LINK_HISTORY;
+        if (sequence < 0 || sequence < robot->plan_sequence) // never sent, or overtaken by a newer plan
+        {
+            continue;
+        }
+        robot->explored = plan.depth == 0;
+        if (!robot->explored)
+        {
+            robot->plan = plan;
+            robot->plan_sequence = sequence;
+            robot->have_plan = true;
+        }
+    }
+}
+
+/**
+ * Finds the planned move for the cell of the last observation. The plan is followed from the cell it was made
+ * for, and used if the robot is anywhere on that path, even if it got there on its own while the plan was on
+ * its way, but never into a wall the robot has seen
+ * @param *robot robot side of the link
+ * @param walls absolute wall bits of the cell the robot is in
+ * @return direction to leave the cell in, -1 if the onboard logic has to decide
+ */
+int link_robot_move(const LinkRobot *robot, int walls)
+{
+    int latest = robot->sequence - 1;
+    if (latest < 0 || !robot->have_plan)
+    {
+        return -1;
+    }
+    if (latest - robot->plan_sequence >= LINK_HISTORY) // the cell the plan was made for has been forgotten
+    {
+        return -1;
+    }
+
+    int row = robot->decision_row[robot->plan_sequence % LINK_HISTORY];
+    int column = robot->decision_column[robot->plan_sequence % LINK_HISTORY];
+    int now = latest % LINK_HISTORY;
+    for (int i = 0; i < robot->plan.depth; i++)
+    {
+        int move = robot->plan.moves[i];
+        if (row == robot->decision_row[now] && column == robot->decision_column[now])
+        {
+            return (walls >> move) & 1 ? -1 : move;
+        }
+        row += sim_step_row(move);
+        column += sim_step_column(move);
+    }
+    return -1;
+}
@@ -0,0 +1,90 @@
+#ifndef MAZE_LINK
+#define MAZE_LINK
+
+#include <stdbool.h>
+
+/*
+ * Offloaded planning: the robot sends a short observation of the start cell and every cell it stops in to a host planner,
+ * which answers each one with the next few moves. The robot keeps the newest plan and takes its moves as
+ * long as it is still on the planned path, so it can keep driving while the host works on the next plan,
+ * and falls back to wall_based_movement() when there is no usable plan.
+ *
+ * Frames are printable so they can go through BTSendString(), every field is one character of '0' + value:
+ *   observation  O sequence row column walls direction \n
+ *   plan         P sequence depth move ... \n
+ * A plan with no moves says the planner has nothing left to explore.
+ */
+
+#define LINK_MAX_DEPTH 16                      // most moves a plan can hold
+#define LINK_HISTORY 64                        // sequence numbers wrap at this, older observations are forgotten
+#define LINK_FRAME_BYTES (LINK_MAX_DEPTH + 4)  // longest frame, a full plan with its newline
+#define LINK_FOUND_FOOD 0x10                   // in the walls field, the robot backed out into the last cell
+#define LINK_FOUND_WATER 0x20
+
+#ifndef LINK_WAIT_MS
+#define LINK_WAIT_MS 250 // how long the robot waits for a late plan before deciding on its own, a round trip that
+                         // still lets mazeOffload robots take most moves from a plan of depth 1
+#endif
+
+/*
+ * A byte link to the planner, e.g. bluetooth on the robot or a pipe in the simulator
+ */
+typedef struct PlanLink
+{
+    void *context;
+    void (*send)(void *context, const char *frame, int length);
+    int (*receive)(void *context, char *buffer, int capacity); // doesn't wait, returns the number of bytes read
+} PlanLink;
+
+typedef struct LinkObservation
+{
+    int sequence;  // counts up from 0 with every cell
+    int row;       // cell the walls were read in
+    int column;
+    int walls;     // absolute wall bits, bit n is a wall in direction n (N - 0, E - 1, S - 2, W - 3), and LINK_FOUND_ bits
+    int direction; // the robot drove into the cell facing this way
+} LinkObservation;
+
+typedef struct LinkPlan
+{
+    int sequence; // observation it answers, wrapped to LINK_HISTORY
+    int depth;
+    int moves[LINK_MAX_DEPTH]; // absolute direction to leave each cell in, starting with the cell of the observation
+} LinkPlan;
+
+/*
+ * Gathers received bytes into whole frames
+ */
+typedef struct LinkReader
+{
+    char frame[LINK_FRAME_BYTES];
+    int length;
+} LinkReader;
+
+/*
+ * Robot side of the link
+ */
+typedef struct LinkRobot
+{
+    int sequence;                    // of the next observation
+    int decision_row[LINK_HISTORY];  // cell the robot chose its move in after each observation
+    int decision_column[LINK_HISTORY];
+    bool have_plan;
+    bool explored;      // the planner's last answer had no moves, there is nothing to wait for
+    LinkPlan plan;      // newest plan received
+    int plan_sequence;  // observation the plan answers, unwrapped
+    LinkReader reader;
+} LinkRobot;
+
+int link_encode_observation(char *frame, const LinkObservation *observation);
+bool link_decode_observation(const char *frame, int length, LinkObservation *observation);
+int link_encode_plan(char *frame, const LinkPlan *plan);
+bool link_decode_plan(const char *frame, int length, LinkPlan *plan);
+int link_read_frame(LinkReader *reader, const PlanLink *link);
+
+void link_robot_init(LinkRobot *robot);
+void link_robot_observe(LinkRobot *robot, const PlanLink *link, LinkObservation *observation, int decision_row, int decision_column);
+void link_robot_poll(LinkRobot *robot, const PlanLink *link);
+int link_robot_move(const LinkRobot *robot, int walls);
+
+#endif
@@ -0,0 +1,130 @@
+#include "mazeLinkPipe.h"
+#include "mazeSim.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LINK_PIPE_HEADER 5 // arrival time and length in front of every frame
+
+static void link_pipe_send(void *context, const char *frame, int length)
+{
+    LinkPipeEnd *end = context;
+    LinkPipe *channel = end->channel;
+    uint32_t sent_ms = end->replies_on_receipt ? end->last_arrival_ms : *channel->now_ms;
+    uint32_t arrival_ms = sent_ms + channel->latency_ms;
+    unsigned char record[LINK_PIPE_HEADER + LINK_FRAME_BYTES];
+
+    channel->frames++;
+    channel->bytes += length;
+    if ((int)(sim_random(&channel->rng) % 100) < channel->loss || length > LINK_FRAME_BYTES)
+    {
+        channel->lost++;
+        return;
+    }
+    memcpy(record, &arrival_ms, sizeof(arrival_ms));
+    record[4] = (unsigned char)length;
+    memcpy(record + LINK_PIPE_HEADER, frame, length);
+    if (write(end->write_fd, record, LINK_PIPE_HEADER + length) != LINK_PIPE_HEADER + length) // a full pipe loses it too
+    {
+        channel->lost++;
+    }
+}
+
+static int link_pipe_receive(void *context, char *buffer, int capacity)
+{
+    LinkPipeEnd *end = context;
+    if (!end->have_head) // records are written whole, so the header and frame are either both there or not yet
+    {
+        unsigned char header[LINK_PIPE_HEADER];
+        if (read(end->read_fd, header, LINK_PIPE_HEADER) != LINK_PIPE_HEADER)
+        {
+            return 0;
+        }
+        memcpy(&end->head_ms, header, sizeof(end->head_ms));
+        end->head_length = header[4];
+        if (read(end->read_fd, end->head, end->head_length) != end->head_length)
+        {
+            return 0;
+        }
+        end->head_offset = 0;
+        end->have_head = true;
+    }
+    if (end->head_ms > *end->channel->now_ms) // still on its way
+    {
+        return 0;
+    }
+
+    int count = end->head_length - end->head_offset < capacity ? end->head_length - end->head_offset : capacity;
+    memcpy(buffer, end->head + end->head_offset, count);
+    end->head_offset += count;
+    end->last_arrival_ms = end->head_ms;
+    if (end->head_offset == end->head_length)
+    {
+        end->have_head = false;
+    }
+    return count;
+}
+
+static bool link_pipe_end(LinkPipe *channel, LinkPipeEnd *end, int read_fd, int write_fd)
+{
+    end->link.context = end;
+    end->link.send = link_pipe_send;
+    end->link.receive = link_pipe_receive;
+    end->channel = channel;
+    end->read_fd = read_fd;
+    end->write_fd = write_fd;
+    return fcntl(read_fd, F_SETFL, O_NONBLOCK) == 0 && fcntl(write_fd, F_SETFL, O_NONBLOCK) == 0;
+}
+
+/**
+ * This function opens the two pipes of the stand-in link, the planner's end answers as soon as a frame arrives
+ * @param *channel link to set up, robot.link and host.link are the two ends
+ * @param *now_ms simulated clock both ends read
+ * @param latency_ms time a frame takes one way, half the round trip
+ * @param loss percent of frames dropped
+ * @param seed picks which frames are dropped
+ * @return false if the pipes couldn't be made
+ */
+bool link_pipe_open(LinkPipe *channel, const uint32_t *now_ms, uint32_t latency_ms, int loss, uint32_t seed)
+{
+    int to_host[2];
+    int to_robot[2];
+
+    memset(channel, 0, sizeof(LinkPipe));
+    channel->now_ms = now_ms;
+    channel->latency_ms = latency_ms;
+    channel->loss = loss;
+    channel->rng = seed ? seed : 0x6d2b79f5;
+    channel->robot.read_fd = channel->robot.write_fd = channel->host.read_fd = channel->host.write_fd = -1;
+    if (pipe(to_host) != 0)
+    {
+        return false;
+    }
+    if (pipe(to_robot) != 0)
+    {
+        close(to_host[0]);
+        close(to_host[1]);
+        return false;
+    }
+    channel->host.replies_on_receipt = true;
+    bool ok = link_pipe_end(channel, &channel->robot, to_robot[0], to_host[1]);
+    ok &= link_pipe_end(channel, &channel->host, to_host[0], to_robot[1]);
+    if (!ok)
+    {
+        link_pipe_close(channel);
+    }
+    return ok;
+}
+
+void link_pipe_close(LinkPipe *channel)
+{
+    int fds[4] = {channel->robot.read_fd, channel->robot.write_fd, channel->host.read_fd, channel->host.write_fd};
+    for (int i = 0; i < 4; i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+    channel->robot.read_fd = channel->robot.write_fd = channel->host.read_fd = channel->host.write_fd = -1;
+}
@@ -0,0 +1,47 @@
+#ifndef MAZE_LINK_PIPE
+#define MAZE_LINK_PIPE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mazeLink.h"
+
+/*
+ * Stand-in for the bluetooth link on the host: two pipes carry frames between the robot and the planner, each
+ * one stamped with the simulated time it arrives so the link has a fixed latency, and a share of frames are lost.
+ */
+
+typedef struct LinkPipe LinkPipe;
+
+typedef struct LinkPipeEnd
+{
+    PlanLink link; // what the robot or the planner talks through
+    LinkPipe *channel;
+    int read_fd;
+    int write_fd;
+    bool replies_on_receipt; // sends are stamped from the last arrival instead of the clock, a planner with no think time
+    bool have_head;          // a frame has been read from the pipe but hasn't arrived yet
+    uint32_t head_ms;
+    char head[LINK_FRAME_BYTES];
+    int head_length;
+    int head_offset; // bytes of the head already handed out
+    uint32_t last_arrival_ms;
+} LinkPipeEnd;
+
+struct LinkPipe
+{
+    const uint32_t *now_ms; // simulated clock
+    uint32_t latency_ms;    // one way
+    int loss;               // percent of frames dropped
+    uint32_t rng;
+    long frames;
+    long lost;
+    long bytes;
+    LinkPipeEnd robot;
+    LinkPipeEnd host;
+};
+
+bool link_pipe_open(LinkPipe *channel, const uint32_t *now_ms, uint32_t latency_ms, int loss, uint32_t seed);
+void link_pipe_close(LinkPipe *channel);
+
+#endif
@@ -0,0 +1,227 @@
+#include "mazeGen.h"
+#include "mazeLinkPipe.h"
+#include "mazePlanner.h"
+#include "mazeSim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Host program that measures how much the plan depth of offloaded planning hides the round trip time of the
+ * link. Every robot drives a simulated maze talking to a planner through the pipe stand-in (mazeLinkPipe.h), for
+ * each round trip time and plan depth below, next to the same robots deciding everything onboard.
+ * usage: mazeOffload [-k maze kind] [-s size] [-m mazes] [-r robots] [-n noise] [-l loss percent] [-w wait ms] [-S seed]
+ */
+
+#define OFFLOAD_POLL_MS 10 // how often a waiting robot looks for a plan
+
+static const int round_trips[] = {0, 250, 500, 2000, 4000, 8000, 16000}; // a cell takes the robot about 2750 ms
+static const int depths[] = {1, 2, 4, 8, 16};
+#define NUMBER_OF_ROUND_TRIPS (int)(sizeof(round_trips) / sizeof(round_trips[0]))
+#define NUMBER_OF_DEPTHS (int)(sizeof(depths) / sizeof(depths[0]))
+
+typedef struct OffloadStats
+{
+    long runs;
+    long successes;
+    double time_ms;
+    long planned;   // moves taken from a plan
+    long fallbacks; // moves the onboard logic chose
+    double stall_ms; // waiting for late plans
+    long link_bytes;
+} OffloadStats;
+
+/*
+ * Drives one robot through the maze, asking the planner for every move when round_trip_ms isn't negative
+ * @return false if the pipes couldn't be opened
+ */
+static bool run_robot(SimRobot *sim, const SimMaze *maze, const SimConfig *config, uint32_t seed, int round_trip_ms,
+                      int depth, int loss, int wait_ms, OffloadStats *stats)
+{
+    sim_robot_init(sim, maze, config, seed);
+    if (round_trip_ms < 0)
+    {
+        sim_robot_run(sim, maze, config);
+    }
+    else
+    {
+        uint32_t clock = sim->time_ms;
+        LinkPipe channel;
+        LinkPlanner planner;
+        LinkRobot robot;
+        if (!link_pipe_open(&channel, &clock, (uint32_t)round_trip_ms / 2, loss, seed))
+        {
+            return false;
+        }
+        planner_init(&planner, maze->rows, maze->columns, depth);
+        link_robot_init(&robot);
+
+        LinkObservation start; // the start cell goes to the planner before the first move, as on the robot
+        start.row = sim->row;
+        start.column = sim->column;
+        start.direction = sim->robot.direction;
+        start.walls = sim_robot_look(sim, maze);
+        link_robot_observe(&robot, &channel.robot.link, &start, sim->row, sim->column);
+
+        int found = 0;
+        while (sim_robot_sense(sim, maze))
+        {
+            LinkObservation observation;
+            bool backed_out = sim->food_found + sim->water_found != found; // the walls were read one cell on
+            found = sim->food_found + sim->water_found;
+            observation.direction = sim->robot.direction;
+            observation.row = sim->row + (backed_out ? sim_step_row(observation.direction) : 0);
+            observation.column = sim->column + (backed_out ? sim_step_column(observation.direction) : 0);
+            observation.walls = sim->cells[observation.row * maze->columns + observation.column] & SIM_CELL_WALLS;
+            if (backed_out)
+            {
+                bool food = observation.row == maze->food_row && observation.column == maze->food_column;
+                observation.walls |= food ? LINK_FOUND_FOOD : LINK_FOUND_WATER;
+            }
+            clock = sim->time_ms;
+            link_robot_observe(&robot, &channel.robot.link, &observation, sim->row, sim->column);
+
+            int walls = sim->cells[sim->row * maze->columns + sim->column] & SIM_CELL_WALLS;
+            int waited = 0;
+            int move;
+            while (1)
+            {
+                planner_poll(&planner, &channel.host.link);
+                link_robot_poll(&robot, &channel.robot.link);
+                move = link_robot_move(&robot, walls);
+                if (move >= 0 || robot.explored || waited >= wait_ms)
+                {
+                    break;
+                }
+                sim->time_ms += OFFLOAD_POLL_MS;
+                waited += OFFLOAD_POLL_MS;
+                clock = sim->time_ms;
+            }
+            stats->planned += move >= 0;
+            stats->fallbacks += move < 0;
+            stats->stall_ms += waited;
+            sim_robot_decide(sim, maze, config, move);
+        }
+        stats->link_bytes += channel.bytes;
+        link_pipe_close(&channel);
+    }
+    stats->runs++;
+    stats->successes += sim_succeeded(maze, sim->failed, sim->food_found, sim->water_found, sim->shelter_found);
+    stats->time_ms += sim->time_ms;
+    return true;
+}
+
+static void print_stats(const char *round_trip, const char *depth, const OffloadStats *stats)
+{
+    long moves = stats->planned + stats->fallbacks;
+    printf("%8s %6s %8.3f %9.0f %8.3f %9.1f %11.1f\n", round_trip, depth, moves ? (double)stats->planned / moves : 0,
+           moves ? stats->stall_ms / moves : 0, (double)stats->successes / stats->runs, stats->time_ms / stats->runs / 1000,
+           moves ? (double)stats->link_bytes / moves : 0);
+}
+
+int main(int argc, char **argv)
+{
+    int kind = MAZE_PERFECT;
+    int size = 8;
+    int number_of_mazes = 16;
+    int robots = 8;
+    int loss = 10;
+    int wait_ms = LINK_WAIT_MS;
+    uint32_t seed = 1;
+    SimConfig config = {0, 0, CONTROLLER_PARAMS_DEFAULT};
+
+    int option;
+    while ((option = getopt(argc, argv, "k:s:m:r:n:l:w:S:")) != -1)
+    {
+        switch (option)
+        {
+        case 'k':
+            kind = atoi(optarg);
+            break;
+        case 's':
+            size = atoi(optarg);
+            break;
+        case 'm':
+            number_of_mazes = atoi(optarg);
+            break;
+        case 'r':
+            robots = atoi(optarg);
+            break;
+        case 'n':
+            config.noise = atoi(optarg);
+            break;
+        case 'l':
+            loss = atoi(optarg);
+            break;
+        case 'w':
+            wait_ms = atoi(optarg);
+            break;
+        case 'S':
+            seed = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-k maze kind] [-s size] [-m mazes] [-r robots] [-n noise] [-l loss percent] [-w wait ms] [-S seed]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (kind < 0 || kind >= MAZE_KINDS || size < 2 || size > SIM_MAX_SIZE || number_of_mazes < 1 || robots < 1 || loss < 0 || loss > 100 || wait_ms < 0)
+    {
+        fprintf(stderr, "kind goes from 0 to %d, size from 2 to %d, loss from 0 to 100\n", MAZE_KINDS - 1, SIM_MAX_SIZE);
+        return 1;
+    }
+    config.max_ticks = size * size * 8;
+
+    SimRobot *sim = malloc(sizeof(SimRobot));
+    uint8_t *edges = malloc((size_t)number_of_mazes * SIM_EDGE_BYTES(size, size));
+    SimMaze *mazes = malloc(sizeof(SimMaze) * number_of_mazes);
+    if (sim == NULL || edges == NULL || mazes == NULL)
+    {
+        return 1;
+    }
+    for (int m = 0; m < number_of_mazes; m++)
+    {
+        generate_maze(kind, &mazes[m], edges + m * SIM_EDGE_BYTES(size, size), size, size, sim_seed(seed, m));
+    }
+
+    printf("kind %d, %dx%d mazes, noise %d, %d%% of frames lost, robots wait up to %d ms for a plan\n", kind, size, size, config.noise,
+           loss, wait_ms);
+    printf("%8s %6s %8s %9s %8s %9s %11s\n", "rtt_ms", "depth", "planned", "stall_ms", "success", "time_s", "link_bytes");
+
+    for (int t = -1; t < NUMBER_OF_ROUND_TRIPS; t++) // -1 is every move onboard
+    {
+        for (int d = 0; d < (t < 0 ? 1 : NUMBER_OF_DEPTHS); d++)
+        {
+            OffloadStats stats = {0, 0, 0, 0, 0, 0, 0};
+            for (int m = 0; m < number_of_mazes; m++)
+            {
+                for (int r = 0; r < robots; r++)
+                {
+                    if (!run_robot(sim, &mazes[m], &config, sim_seed(seed + m, r), t < 0 ? -1 : round_trips[t], depths[d],
+                                   loss, wait_ms, &stats))
+                    {
+                        fprintf(stderr, "couldn't open the link pipes\n");
+                        return 1;
+                    }
+                }
+            }
+            if (t < 0)
+            {
+                print_stats("onboard", "-", &stats);
+            }
+            else
+            {
+                char round_trip[16];
+                char depth[16];
+                snprintf(round_trip, sizeof(round_trip), "%d", round_trips[t]);
+                snprintf(depth, sizeof(depth), "%d", depths[d]);
+                print_stats(round_trip, depth, &stats);
+            }
+        }
+    }
+
+    free(mazes);
+    free(edges);
+    free(sim);
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef MAZE_PARAMS
+#define MAZE_PARAMS
+
+/*
+ * Thresholds and timings of the controller. A tuned set written by mazeTuner can be built in with
+ * -DMAZE_PARAMS_FILE=\"tunedParams.h\", anything it leaves out keeps the hand picked value below.
+ */
+#ifdef MAZE_PARAMS_FILE
+#include MAZE_PARAMS_FILE
+#endif
+
+#define OBSTACLE_SENSOR_THRESHOLD 200
+
+#ifndef PARAM_MOTOR_SPEED_LEFT
+#define PARAM_MOTOR_SPEED_LEFT 45
+#endif
+#ifndef PARAM_MOTOR_SPEED_RIGHT
+#define PARAM_MOTOR_SPEED_RIGHT 40
+#endif
+#ifndef PARAM_WALL_THRESHOLD
+#define PARAM_WALL_THRESHOLD (OBSTACLE_SENSOR_THRESHOLD / 5) // ir reading over which set_walls() sees a wall
+#endif
+#ifndef PARAM_FACING_WALL_THRESHOLD
+#define PARAM_FACING_WALL_THRESHOLD (OBSTACLE_SENSOR_THRESHOLD / 4) // front reading over which the robot turns before driving
+#endif
+#ifndef PARAM_LIGHT_THRESHOLD
+#define PARAM_LIGHT_THRESHOLD 400 // light reading under which the cell is the shelter
+#endif
+#ifndef PARAM_EXTRA_LINE_DELAY_MS
+#define PARAM_EXTRA_LINE_DELAY_MS 200 // time after the big line before extra lines are counted
+#endif
+#ifndef PARAM_EXTRA_LINE_RESET_MS
+#define PARAM_EXTRA_LINE_RESET_MS 100 // time before another extra line can be counted
+#endif
+#ifndef PARAM_LINE_STOP_MS
+#define PARAM_LINE_STOP_MS 450 // time after the big line before the robot stops in the middle of the cell
+#endif
+#ifndef PARAM_PAUSE_MS
+#define PARAM_PAUSE_MS 1250 // time the robot stays stopped in a cell
+#endif
+#ifndef PARAM_ADJUST_THRESHOLD
+#define PARAM_ADJUST_THRESHOLD 250 // difference between the front sensors that adjust_for_wall() corrects
+#endif
+#ifndef PARAM_ADJUST_TIMEOUT_MS
+#define PARAM_ADJUST_TIMEOUT_MS 500 // longest adjust_for_wall() spends correcting
+#endif
+#if PARAM_EXTRA_LINE_DELAY_MS < 0 || PARAM_EXTRA_LINE_RESET_MS < 0 || PARAM_LINE_STOP_MS < 0 || PARAM_PAUSE_MS < 0 || \
+    PARAM_ADJUST_TIMEOUT_MS < 0
+#error "the PARAM_..._MS timings are compared with ClockMS() differences and can't be negative"
+#endif
+
+typedef struct ControllerParams
+{
+    int motor_speed_left;
+    int motor_speed_right;
+    int wall_threshold;
+    int facing_wall_threshold;
+    int light_threshold;
+    int extra_line_delay_ms; // the _ms timings are never negative, see the check above
+    int extra_line_reset_ms;
+    int line_stop_ms;
+    int pause_ms;
+    int adjust_threshold;
+    int adjust_timeout_ms;
+} ControllerParams;
+
+#define CONTROLLER_PARAMS_DEFAULT                                                                  \
+    {                                                                                              \
+        PARAM_MOTOR_SPEED_LEFT, PARAM_MOTOR_SPEED_RIGHT, PARAM_WALL_THRESHOLD,                     \
+            PARAM_FACING_WALL_THRESHOLD, PARAM_LIGHT_THRESHOLD, PARAM_EXTRA_LINE_DELAY_MS,         \
+            PARAM_EXTRA_LINE_RESET_MS, PARAM_LINE_STOP_MS, PARAM_PAUSE_MS, PARAM_ADJUST_THRESHOLD, \
+            PARAM_ADJUST_TIMEOUT_MS                                                                \
+    }
+
+#endif
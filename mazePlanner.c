@@ -0,0 +1,201 @@
+#include "mazePlanner.h"
+#include "mazeSim.h"
+#include <string.h>
+
+/*
+ * What planner_plan() hands to sim_search()
+ */
+typedef struct PlannerSearch
+{
+    const LinkPlanner *planner;
+    int start;
+    bool stranded; // the observation of the start cell was lost, nothing is known about it, so guess its way
+    // out, the robot turns away from a wall it finds in front
+} PlannerSearch;
+
+static bool planner_inside(const LinkPlanner *planner, int row, int column)
+{
+    return row >= 0 && row < planner->rows && column >= 0 && column < planner->columns;
+}
+
+/*
+ * The robot backs out of food and water, so the planner never routes through them
+ */
+static bool planner_blocked(const LinkPlanner *planner, int cell)
+{
+    return planner->cells[cell] & (LINK_FOUND_FOOD | LINK_FOUND_WATER);
+}
+
+/*
+ * Whether the map says the robot can drive from a cell in a direction, from either cell's walls
+ * @param guess what to say when neither cell has been observed
+ * @return the cell it gets to, -1 if it can't or nobody knows
+ */
+static int planner_next(const LinkPlanner *planner, int cell, int direction, bool guess)
+{
+    int row = cell / planner->columns + sim_step_row(direction);
+    int column = cell % planner->columns + sim_step_column(direction);
+    if (!planner_inside(planner, row, column))
+    {
+        return -1;
+    }
+    int next = row * planner->columns + column;
+    bool open;
+    if (planner->cells[cell] & PLANNER_OBSERVED)
+    {
+        open = !((planner->cells[cell] >> direction) & 1);
+    }
+    else if (planner->cells[next] & PLANNER_OBSERVED)
+    {
+        open = !((planner->cells[next] >> ((direction + 2) % 4)) & 1);
+    }
+    else
+    {
+        open = guess;
+    }
+    return open && !planner_blocked(planner, next) ? next : -1;
+}
+
+/*
+ * Cell the robot decides its next move in after an observation, it backs out of food and water
+ */
+static int planner_decision_cell(const LinkPlanner *planner, const LinkObservation *observation)
+{
+    int row = observation->row;
+    int column = observation->column;
+    if (observation->walls & (LINK_FOUND_FOOD | LINK_FOUND_WATER))
+    {
+        row -= sim_step_row(observation->direction);
+        column -= sim_step_column(observation->direction);
+    }
+    return row * planner->columns + column;
+}
+
+static int planner_search_next(void *context, int cell, int direction)
+{
+    const PlannerSearch *search = context;
+    return planner_next(search->planner, cell, direction, search->stranded && cell == search->start);
+}
+
+/*
+ * The search stops at the nearest cell that hasn't been observed
+ */
+static bool planner_search_target(void *context, int cell)
+{
+    const PlannerSearch *search = context;
+    return !(search->planner->cells[cell] & PLANNER_OBSERVED);
+}
+
+/**
+ * This function sets up an empty map
+ * @param *planner planner to set up
+ * @param rows, columns size of the maze, up to PLANNER_MAX_SIZE
+ * @param depth moves to send with every plan, kept to 1 to LINK_MAX_DEPTH
+ */
+void planner_init(LinkPlanner *planner, int rows, int columns, int depth)
+{
+    memset(planner, 0, sizeof(LinkPlanner));
+    planner->rows = rows;
+    planner->columns = columns;
+    planner->depth = depth < 1 ? 1 : depth > LINK_MAX_DEPTH ? LINK_MAX_DEPTH : depth;
+}
+
+/**
+ * Puts an observation on the map
+ */
+void planner_update(LinkPlanner *planner, const LinkObservation *observation)
+{
+    if (!planner_inside(planner, observation->row, observation->column))
+    {
+        return;
+    }
+    planner->cells[observation->row * planner->columns + observation->column] =
+        (uint8_t)(observation->walls | PLANNER_OBSERVED);
+    planner->observations++;
+}
+
+/**
+ * Plans the moves after an observation, a plan with a depth of 0 means there is nothing left to explore
+ * @param *planner planner with the observation already on its map
+ * @param *observation observation to answer
+ * @param *plan filled in with the moves
+ */
+void planner_plan(const LinkPlanner *planner, const LinkObservation *observation, LinkPlan *plan)
+{
+    int cell_count = planner->rows * planner->columns;
+    int start = planner_decision_cell(planner, observation);
+    int came_from[PLANNER_MAX_SIZE * PLANNER_MAX_SIZE];
+
+    plan->sequence = observation->sequence;
+    plan->depth = 0;
+    if (start < 0 || start >= cell_count)
+    {
+        return;
+    }
+
+    PlannerSearch search = {planner, start, !(planner->cells[start] & PLANNER_OBSERVED)};
+    int target = sim_search(cell_count, start, observation->direction, planner_search_next, planner_search_target,
+                            &search, came_from);
+    if (target < 0)
+    {
+        return;
+    }
+
+    int path[PLANNER_MAX_SIZE * PLANNER_MAX_SIZE];
+    int length = sim_search_path(planner->columns, came_from, start, target, path);
+    for (int i = 0; i < length && plan->depth < planner->depth; i++)
+    {
+        plan->moves[plan->depth++] = path[i];
+    }
+
+    bool guessed[PLANNER_MAX_SIZE * PLANNER_MAX_SIZE] = {false};
+    int cell = target;
+    int direction = plan->moves[plan->depth - 1];
+    guessed[target] = true;
+    while (plan->depth < planner->depth) // past the target the walls aren't known, guess at the next new cell
+    {
+        int turns[4] = {direction, (direction + 1) % 4, (direction + 3) % 4, -1};
+        int next = -1;
+        for (int i = 0; turns[i] >= 0 && next < 0; i++)
+        {
+            int row = cell / planner->columns + sim_step_row(turns[i]);
+            int column = cell % planner->columns + sim_step_column(turns[i]);
+            int candidate = row * planner->columns + column;
+            if (planner_inside(planner, row, column) && !(planner->cells[candidate] & PLANNER_OBSERVED) && !guessed[candidate])
+            {
+                next = candidate;
+                direction = turns[i];
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        plan->moves[plan->depth++] = direction;
+        guessed[next] = true;
+        cell = next;
+    }
+}
+
+/**
+ * Answers every observation that has arrived on the link, in order
+ */
+void planner_poll(LinkPlanner *planner, const PlanLink *link)
+{
+    int length;
+    while ((length = link_read_frame(&planner->reader, link)) > 0)
+    {
+        LinkObservation observation;
+        if (!link_decode_observation(planner->reader.frame, length, &observation))
+        {
+            continue;
+        }
+        planner_update(planner, &observation);
+
+        LinkPlan plan;
+        planner_plan(planner, &observation, &plan);
+        char frame[LINK_FRAME_BYTES];
+        link->send(link->context, frame, link_encode_plan(frame, &plan));
+        planner->plans++;
+    }
+}
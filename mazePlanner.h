@@ -0,0 +1,34 @@
+#ifndef MAZE_PLANNER
+#define MAZE_PLANNER
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mazeLink.h"
+
+#define PLANNER_MAX_SIZE 32 // up to SIM_MAX_SIZE, the map is searched with sim_search()
+#define PLANNER_OBSERVED 0x80 // cell bit next to the wall bits and LINK_FOUND_ bits of its observation
+
+/*
+ * Host planner for the offloaded planning link. It builds a map from the robot's observations and answers each
+ * one with the shortest path to the nearest cell that hasn't been observed, carried on past it as far as the
+ * plan depth allows as a guess at the unknown cells beyond. The robot observes the start cell before its first
+ * move, so every cell it has been in is on the map unless the observation was lost.
+ */
+typedef struct LinkPlanner
+{
+    int rows;
+    int columns;
+    int depth; // moves sent with every plan
+    uint8_t cells[PLANNER_MAX_SIZE * PLANNER_MAX_SIZE];
+    LinkReader reader;
+    int observations; // received
+    int plans;        // sent
+} LinkPlanner;
+
+void planner_init(LinkPlanner *planner, int rows, int columns, int depth);
+void planner_update(LinkPlanner *planner, const LinkObservation *observation);
+void planner_plan(const LinkPlanner *planner, const LinkObservation *observation, LinkPlan *plan);
+void planner_poll(LinkPlanner *planner, const PlanLink *link);
+
+#endif
@@ -0,0 +1,898 @@
+#include "mazeSim.h"
+#include "mazeDecide.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const int32_t ir_by_distance[SIM_IR_RANGE + 1] = {120, 35, 10, 0}; // ir reading for a wall n cells away
+
+/*
+ * Returns a number between -noise and +noise, uses a multiply instead of % so it vectorises
+ */
+static inline int32_t sim_noise(uint32_t *state, int32_t noise)
+{
+    return (int32_t)(((uint64_t)sim_random(state) * (uint32_t)(2 * noise + 1)) >> 32) - noise;
+}
+
+/**
+ * This function sets or clears a wall in the packed edges, the neighbouring cell shares the same bit
+ * @param *edges packed wall bits to change
+ * @param rows, columns size of the maze
+ * @param row, column, direction the wall to change
+ * @param wall true to put the wall up
+ */
+void sim_set_wall(uint8_t *edges, int rows, int columns, int row, int column, int direction, bool wall)
+{
+    int bit = sim_edge_index(rows, columns, row, column, direction);
+    if (wall)
+    {
+        edges[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+    }
+    else
+    {
+        edges[bit >> 3] &= (uint8_t)~(1 << (bit & 7));
+    }
+}
+
+/**
+ * Gets the noise seed for one robot out of a run seed, so the scalar and batch robots line up
+ */
+uint32_t sim_seed(uint32_t seed, int robot)
+{
+    uint32_t state = seed ^ ((uint32_t)robot * 0x9e3779b9u);
+    return state ? state : 0x6d2b79f5u; // xorshift gets stuck on 0
+}
+
+/**
+ * Wall clock for timing runs, in seconds from an arbitrary start
+ */
+double sim_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * This function runs a breadth first search from a cell, going straight on first, then right, left and back, for the
+ * nearest cell that passes the target test. It is the search of the offboard planner and of a team choosing
+ * where to go, each with their own map behind next.
+ * @param cell_count cells in the maze, up to SIM_MAX_CELLS, numbered row * columns + column
+ * @param start cell to search from
+ * @param heading way the robot is facing in it
+ * @param next edge test, what the map says about driving from a cell in a direction
+ * @param target target test
+ * @param *context passed to next and target
+ * @param *came_from filled in with the direction each cell was reached in, -1 if it wasn't
+ * @return the cell the search stopped at, -1 if no reachable cell passed the target test
+ */
+int sim_search(int cell_count, int start, int heading, SimSearchNext next, SimSearchTarget target, void *context,
+               int *came_from)
+{
+    int order[4] = {heading, (heading + 1) % 4, (heading + 3) % 4, (heading + 2) % 4};
+    int queue[SIM_MAX_CELLS];
+    int head = 0;
+    int tail = 0;
+
+    for (int c = 0; c < cell_count; c++)
+    {
+        came_from[c] = -1;
+    }
+    came_from[start] = 4; // anything but -1
+    queue[tail++] = start;
+    while (head < tail)
+    {
+        int cell = queue[head++];
+        for (int i = 0; i < 4; i++)
+        {
+            int reached = next(context, cell, order[i]);
+            if (reached < 0 || came_from[reached] >= 0)
+            {
+                continue;
+            }
+            came_from[reached] = order[i];
+            queue[tail++] = reached;
+            if (target(context, reached))
+            {
+                return reached;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * This function gives the moves from the start of a sim_search() to a cell it reached
+ * @param columns columns of the maze
+ * @param *came_from filled in by sim_search()
+ * @param start, target cells the path goes between
+ * @param *path filled in with the direction to leave each cell in, starting with start
+ * @return number of moves
+ */
+int sim_search_path(int columns, const int *came_from, int start, int target, int *path)
+{
+    int length = 0;
+    for (int cell = target; cell != start; length++)
+    {
+        cell = (cell / columns - sim_step_row(came_from[cell])) * columns + cell % columns - sim_step_column(came_from[cell]);
+    }
+    for (int cell = target, i = length - 1; cell != start; i--)
+    {
+        path[i] = came_from[cell];
+        cell = (cell / columns - sim_step_row(path[i])) * columns + cell % columns - sim_step_column(path[i]);
+    }
+    return length;
+}
+
+/**
+ * Counts the open cells in a direction until a wall is hit, up to SIM_IR_RANGE
+ */
+static int sim_raycast(const SimMaze *maze, int row, int column, int direction)
+{
+    int distance = 0;
+    while (distance < SIM_IR_RANGE && !sim_has_wall(maze, row, column, direction))
+    {
+        row += sim_step_row(direction);
+        column += sim_step_column(direction);
+        distance++;
+    }
+    return distance;
+}
+
+/**
+ * This function works out what a set of controller params means for the simulated robot. The motor speeds
+ * set the drive time and shaking, the stop time where in the cell the robot stops, the motor balance how
+ * far it drifts, adjust_for_wall() how much of the drift it takes out and the pause whether it has settled
+ * @param *model filled in from the params
+ * @param *config params and base noise
+ */
+void sim_model(SimModel *model, const SimConfig *config)
+{
+    const ControllerParams *params = &config->params;
+    int speed_sum = params->motor_speed_left + params->motor_speed_right; // twice the average speed
+    if (speed_sum < 2)
+    {
+        speed_sum = 2;
+    }
+
+    int offset = (params->line_stop_ms * speed_sum / 2 - SIM_LINE_TO_CENTRE) * 100 / SIM_CELL_TRAVEL; // percent of a cell past the middle
+    offset = offset > 50 ? 50 : offset < -50 ? -50 : offset;
+
+    int drift = abs(params->motor_speed_left - params->motor_speed_right - SIM_MOTOR_TRIM) * SIM_DRIFT_GAIN;
+    int threshold = params->adjust_threshold > 1 ? params->adjust_threshold : 1;
+    int adjust_needed = drift ? SIM_ADJUST_MS * PARAM_ADJUST_THRESHOLD / threshold : 0; // a tighter threshold takes longer
+    int adjust_spent = adjust_needed < params->adjust_timeout_ms ? adjust_needed : params->adjust_timeout_ms;
+    int residual = drift < threshold / SIM_ADJUST_RESIDUAL ? drift : threshold / SIM_ADJUST_RESIDUAL;
+    int side_bias = adjust_needed ? drift - (drift - residual) * adjust_spent / adjust_needed : 0;
+
+    int shaking = speed_sum / 2 > SIM_SMOOTH_SPEED ? (speed_sum / 2 - SIM_SMOOTH_SPEED) * SIM_SPEED_NOISE : 0;
+    int unsettled = SIM_SETTLE_MS + adjust_spent - params->pause_ms; // still moving when the walls are read
+    unsettled = unsettled > 0 ? unsettled / 8 : 0;
+
+    int first_line_ms = SIM_EXTRA_LINE_GAP * 2 / speed_sum;
+    int spacing_ms = SIM_EXTRA_LINE_SPACING * 2 / speed_sum;
+
+    model->drive_ms = SIM_CELL_TRAVEL * 2 / speed_sum;
+    model->pause_ms = params->pause_ms;
+    model->front_scale = 100 + offset * SIM_OFFSET_GAIN;
+    model->rear_scale = 100 - offset * SIM_OFFSET_GAIN;
+    model->side_bias = side_bias;
+    model->noise = config->noise + shaking + unsettled;
+    model->lines_counted = params->extra_line_delay_ms < first_line_ms && params->extra_line_reset_ms < spacing_ms &&
+                           first_line_ms + spacing_ms < params->line_stop_ms;
+    model->wall_threshold = params->wall_threshold;
+    model->facing_wall_threshold = params->facing_wall_threshold;
+    model->light_threshold = params->light_threshold;
+}
+
+/*
+ * Reads an ir sensor, turn is 0 for the front, 1 right, 2 rear and 3 left
+ */
+static int sim_read_ir(SimRobot *sim, const SimMaze *maze, int turn)
+{
+    int direction = (sim->robot.direction + turn) % 4;
+    int reading = ir_by_distance[sim_raycast(maze, sim->row, sim->column, direction)];
+    switch (turn)
+    {
+    case 0:
+        reading = reading * sim->model.front_scale / 100;
+        break;
+    case 1:
+        reading += sim->model.side_bias;
+        break;
+    case 2:
+        reading = reading * sim->model.rear_scale / 100;
+        break;
+    default:
+        reading -= sim->model.side_bias;
+        break;
+    }
+    return reading + sim_noise(&sim->rng, sim->model.noise);
+}
+
+/*
+ * Turns the simulated robot, same DECIDE_ turn types as set_direction()
+ */
+static void sim_turn(SimRobot *sim, int turn_type)
+{
+    switch (turn_type)
+    {
+    case 1:
+        sim->robot.direction = (sim->robot.direction + 1) % 4;
+        sim->turns++;
+        sim->time_ms += SIM_TURN_90_MS;
+        break;
+    case 2:
+        sim->robot.direction = (sim->robot.direction + 3) % 4;
+        sim->turns++;
+        sim->time_ms += SIM_TURN_90_MS;
+        break;
+    case 3:
+        sim->robot.direction = (sim->robot.direction + 2) % 4;
+        sim->u_turns++;
+        sim->time_ms += SIM_TURN_180_MS;
+        break;
+    default:
+        return;
+    }
+    sim->telemetry_bytes += SIM_TELEMETRY_TURN;
+}
+
+/*
+ * Reads the walls of the cell the robot is in like set_walls(), in the order traverse_maze() reads the ir sensors
+ * @param *intersection set if the cell is an intersection, see set_intersection()
+ * @return absolute wall bits of the cell
+ */
+static int sim_read_walls(SimRobot *sim, const SimMaze *maze, bool *intersection)
+{
+    int direction = sim->robot.direction;
+    int front = sim_read_ir(sim, maze, 0);
+    int right = sim_read_ir(sim, maze, 1);
+    int left = sim_read_ir(sim, maze, 3);
+    int rear = sim_read_ir(sim, maze, 2);
+
+    bool front_wall = decide_wall(front, sim->model.wall_threshold); // same test as set_walls()
+    bool right_wall = decide_wall(right, sim->model.wall_threshold);
+    bool rear_wall = decide_wall(rear, sim->model.wall_threshold);
+    bool left_wall = decide_wall(left, sim->model.wall_threshold);
+    *intersection = decide_intersection(front_wall, right_wall, rear_wall, left_wall);
+    return front_wall << direction | right_wall << (direction + 1) % 4 | rear_wall << (direction + 2) % 4 |
+           left_wall << (direction + 3) % 4;
+}
+
+static bool sim_next_visited(const SimRobot *sim, const SimMaze *maze, int direction)
+{
+    int row = sim->row + sim_step_row(direction);
+    int column = sim->column + sim_step_column(direction);
+    if (row < 0 || row >= maze->rows || column < 0 || column >= maze->columns)
+    {
+        return true; // nothing to explore outside of the maze
+    }
+    return sim->cells[row * maze->columns + column] & SIM_CELL_VISITED;
+}
+
+/*
+ * The start of stop_when_line_hit(), run every time the motors start again. If the robot is facing
+ * a wall it turns around or away from the side wall, see decide_departure()
+ */
+static void sim_depart(SimRobot *sim, const SimMaze *maze)
+{
+    int front = sim_read_ir(sim, maze, 0);
+    int rear = sim_read_ir(sim, maze, 2);
+    int left = sim_read_ir(sim, maze, 3);
+    int right = sim_read_ir(sim, maze, 1);
+
+    int turn = decide_departure(front, rear, left, right, sim->model.facing_wall_threshold);
+    if (turn == DECIDE_RIGHT || turn == DECIDE_LEFT)
+    {
+        sim->telemetry_bytes += SIM_TELEMETRY_MOVE; // "Beginning right" or "Beginning left"
+    }
+    sim_turn(sim, turn);
+}
+
+/**
+ * This function puts a robot at the start of the maze, ready to drive
+ * @param *sim robot to set up
+ * @param *maze maze the robot runs in
+ * @param *config params, noise and tick limit
+ * @param seed sensor noise seed, see sim_seed()
+ */
+void sim_robot_init(SimRobot *sim, const SimMaze *maze, const SimConfig *config, uint32_t seed)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim_model(&sim->model, config);
+    sim->row = maze->start_row;
+    sim->column = maze->start_column;
+    sim->robot.direction = maze->start_direction;
+    sim->rng = seed;
+    sim->cells[sim->row * maze->columns + sim->column] = SIM_CELL_VISITED;
+    sim->cells_visited = 1;
+    sim_depart(sim, maze);
+}
+
+/**
+ * This function reads the walls of the cell the robot is in without driving and puts them on its map, as the
+ * firmware does in the start cell before its first move when it plans offboard. The robot is still in the start
+ * cell after sim_robot_init(). The cell isn't marked as an intersection, the firmware leaves that to set_walls()
+ * on the way back in.
+ * @param *sim robot to read with
+ * @param *maze maze the robot runs in
+ * @return absolute wall bits of the cell
+ */
+int sim_robot_look(SimRobot *sim, const SimMaze *maze)
+{
+    bool intersection;
+    int walls = sim_read_walls(sim, maze, &intersection);
+    int cell = sim->row * maze->columns + sim->column;
+    sim->cells[cell] = (sim->cells[cell] & ~SIM_CELL_WALLS) | walls;
+    return walls;
+}
+
+/**
+ * This function drives a robot into the next cell and runs the first half of what traverse_maze() does in
+ * the pause, reading the walls and backing out of food and water
+ * @param *sim robot to move
+ * @param *maze maze the robot runs in
+ * @return true if the robot is in a cell waiting for sim_robot_decide(), false if it has stopped
+ */
+bool sim_robot_sense(SimRobot *sim, const SimMaze *maze)
+{
+    if (sim->done)
+    {
+        return false;
+    }
+    sim->ticks++;
+
+    int direction = sim->robot.direction;
+    if (sim_has_wall(maze, sim->row, sim->column, direction)) // never sees the next line, the robot is stuck
+    {
+        sim->done = true;
+        sim->failed = true;
+        return false;
+    }
+
+    sim->row += sim_step_row(direction);
+    sim->column += sim_step_column(direction);
+    sim->cells_driven++;
+    sim->time_ms += sim->model.drive_ms + sim->model.pause_ms;
+    sim->telemetry_bytes += SIM_TELEMETRY_PAUSE;
+
+    int cell = sim->row * maze->columns + sim->column;
+    if ((sim->cells[cell] & SIM_CELL_INTERSECTION) && sim->backtrack) // traverse_maze() clears it on the way into a known intersection
+    {
+        sim->backtrack = false;
+        sim->telemetry_bytes += SIM_TELEMETRY_INTERSECTION;
+    }
+    if (sim->cells[cell] & SIM_CELL_VISITED)
+    {
+        sim->revisits++;
+    }
+    else
+    {
+        sim->cells[cell] |= SIM_CELL_VISITED;
+        sim->cells_visited++;
+    }
+
+    bool intersection;
+    int walls = sim_read_walls(sim, maze, &intersection);
+    bool in_shelter = sim->row == maze->shelter_row && sim->column == maze->shelter_column;
+    int light = (in_shelter ? SIM_LIGHT_DARK : SIM_LIGHT_OPEN) + sim_noise(&sim->rng, sim->model.noise);
+
+    sim->cells[cell] = (sim->cells[cell] & ~SIM_CELL_WALLS) | walls;
+    if (intersection)
+    {
+        sim->cells[cell] |= SIM_CELL_INTERSECTION;
+    }
+
+    if (light <= sim->model.light_threshold && sim->shelter_found == 0) // only the first dark cell is kept
+    {
+        sim->shelter_found = in_shelter ? 1 : -1;
+    }
+
+    bool on_food = sim->model.lines_counted && sim->row == maze->food_row && sim->column == maze->food_column;
+    bool on_water = sim->model.lines_counted && sim->row == maze->water_row && sim->column == maze->water_column;
+    if (on_food || on_water) // backs out into the last cell
+    {
+        sim->food_found += on_food;
+        sim->water_found += on_water;
+        sim->row -= sim_step_row(direction);
+        sim->column -= sim_step_column(direction);
+        sim->time_ms += SIM_BACKOUT_MS;
+        sim->telemetry_bytes += SIM_TELEMETRY_FOUND;
+        sim->backtrack = true;
+    }
+    return true;
+}
+
+/**
+ * This function runs the second half of the pause, choosing the next move like wall_based_movement() or taking
+ * the one given, then turns away if the robot is left facing a wall
+ * @param *sim robot waiting in a cell after sim_robot_sense()
+ * @param *maze maze the robot runs in
+ * @param *config params, noise and tick limit
+ * @param planned direction to leave the cell in (N - 0, E - 1, S - 2, W - 3), -1 to let the controller choose
+ */
+void sim_robot_decide(SimRobot *sim, const SimMaze *maze, const SimConfig *config, int planned)
+{
+    int direction = sim->robot.direction;
+    int cell = sim->row * maze->columns + sim->column;
+    int walls = sim->cells[cell] & SIM_CELL_WALLS;
+    bool front_wall = (walls >> direction) & 1;
+    bool right_wall = (walls >> ((direction + 1) % 4)) & 1;
+    bool left_wall = (walls >> ((direction + 3) % 4)) & 1;
+
+    if (planned >= 0)
+    {
+        static const int turn_types[4] = {DECIDE_STRAIGHT, DECIDE_RIGHT, DECIDE_AROUND, DECIDE_LEFT}; // by how far right the planned direction is
+        sim_turn(sim, turn_types[(planned - direction + 4) % 4]);
+    }
+    else
+    {
+        bool left_visited = sim_next_visited(sim, maze, (direction + 3) % 4);
+        bool right_visited = sim_next_visited(sim, maze, (direction + 1) % 4);
+        int turn = decide_turn(front_wall, left_wall, right_wall, left_visited, right_visited, sim->backtrack);
+        sim->backtrack = decide_backtrack(turn, sim->backtrack);
+        bool tried = turn != DECIDE_AROUND && (!left_wall || !right_wall); // the messages of wall_based_movement()
+        sim->telemetry_bytes += turn == DECIDE_AROUND || tried ? SIM_TELEMETRY_MOVE : 0;
+        sim->telemetry_bytes += tried && turn == DECIDE_STRAIGHT ? SIM_TELEMETRY_VISITED : 0;
+        sim_turn(sim, turn);
+    }
+
+    if (sim->cells[cell] & SIM_CELL_INTERSECTION) // back at an intersection again
+    {
+        sim->telemetry_bytes += sim->backtrack ? SIM_TELEMETRY_INTERSECTION : 0;
+        sim->backtrack = false;
+    }
+
+    if (sim->cells_visited == maze->rows * maze->columns)
+    {
+        sim->done = true;
+    }
+    else if (sim->ticks >= config->max_ticks)
+    {
+        sim->done = true;
+        sim->failed = true;
+    }
+    else
+    {
+        sim_depart(sim, maze);
+    }
+}
+
+/**
+ * This function drives a robot into the next cell and runs what traverse_maze() does in the pause, reading the
+ * walls, backing out of food and water and choosing the next move like wall_based_movement(), then turns away
+ * if it is left facing a wall
+ * @param *sim robot to move
+ * @param *maze maze the robot runs in
+ * @param *config params, noise and tick limit
+ */
+void sim_robot_step(SimRobot *sim, const SimMaze *maze, const SimConfig *config)
+{
+    if (sim_robot_sense(sim, maze))
+    {
+        sim_robot_decide(sim, maze, config, -1);
+    }
+}
+
+void sim_robot_run(SimRobot *sim, const SimMaze *maze, const SimConfig *config)
+{
+    while (!sim->done)
+    {
+        sim_robot_step(sim, maze, config);
+    }
+}
+
+/*
+ * Lists the signed per robot arrays of a batch so they can be allocated, swapped and freed together,
+ * rng and time_ms are unsigned and are handled on their own
+ */
+static int sim_batch_arrays(SimBatch *batch, int32_t ***arrays)
+{
+    int32_t **list[] = {&batch->id, &batch->row, &batch->column, &batch->direction, &batch->backtrack,
+                        &batch->done, &batch->failed, &batch->ticks, &batch->cells_visited,
+                        &batch->cells_driven, &batch->revisits, &batch->turns, &batch->u_turns,
+                        &batch->food_found, &batch->water_found, &batch->shelter_found, &batch->telemetry_bytes, &batch->moved,
+                        &batch->ir_front, &batch->ir_right, &batch->ir_left, &batch->ir_rear, &batch->light};
+    int number_of_arrays = sizeof(list) / sizeof(list[0]);
+    for (int a = 0; a < number_of_arrays; a++)
+    {
+        arrays[a] = list[a];
+    }
+    return number_of_arrays;
+}
+
+/**
+ * This function sets up a batch of robots on one maze, the start turn is rare and branchy so it
+ * goes through sim_robot_init()
+ * @param *batch batch to set up, free it with sim_batch_free()
+ * @param *maze maze the robots run in, has to outlive the batch
+ * @param *config params, noise and tick limit
+ * @param count number of robots
+ * @param seed run seed, robot i uses sim_seed(seed, i)
+ * @return false if the arrays couldn't be allocated
+ */
+bool sim_batch_init(SimBatch *batch, const SimMaze *maze, const SimConfig *config, int count, uint32_t seed)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->count = count;
+    batch->maze = maze;
+    batch->config = *config;
+    sim_model(&batch->model, config);
+
+    for (int r = 0; r < maze->rows; r++)
+    {
+        for (int c = 0; c < maze->columns; c++)
+        {
+            for (int d = 0; d < 4; d++)
+            {
+                batch->distance[(r * maze->columns + c) * 4 + d] = sim_raycast(maze, r, c, d);
+            }
+        }
+    }
+
+    int32_t **arrays[SIM_BATCH_ARRAYS];
+    int number_of_arrays = sim_batch_arrays(batch, arrays);
+    for (int a = 0; a < number_of_arrays; a++)
+    {
+        *arrays[a] = calloc((size_t)count, sizeof(int32_t));
+        if (*arrays[a] == NULL)
+        {
+            sim_batch_free(batch);
+            return false;
+        }
+    }
+    size_t cell_count = (size_t)maze->rows * maze->columns;
+    batch->rng = calloc((size_t)count, sizeof(uint32_t));
+    batch->time_ms = calloc((size_t)count, sizeof(uint32_t));
+    batch->cells = calloc((size_t)(count + 1) * cell_count, sizeof(int32_t)); // one spare for sim_batch_swap()
+    SimRobot *start = malloc(sizeof(SimRobot));
+    if (batch->rng == NULL || batch->time_ms == NULL || batch->cells == NULL || start == NULL)
+    {
+        free(start);
+        sim_batch_free(batch);
+        return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        sim_robot_init(start, maze, config, sim_seed(seed, i));
+        batch->id[i] = i;
+        batch->row[i] = start->row;
+        batch->column[i] = start->column;
+        batch->direction[i] = start->robot.direction;
+        batch->rng[i] = start->rng;
+        batch->time_ms[i] = start->time_ms;
+        batch->cells_visited[i] = start->cells_visited;
+        batch->turns[i] = start->turns;
+        batch->u_turns[i] = start->u_turns;
+        batch->telemetry_bytes[i] = start->telemetry_bytes;
+        for (size_t c = 0; c < cell_count; c++)
+        {
+            batch->cells[i * cell_count + c] = start->cells[c];
+        }
+    }
+    free(start);
+    return true;
+}
+
+/*
+ * Moves robots first to first + count - 1 one cell, matching sim_robot_step(). It is split into a drive,
+ * a sensor, a decision and a departure pass, each one a loop over the arrays with selects instead of branches
+ */
+static void sim_batch_step_range(SimBatch *batch, int first, int count)
+{
+    const SimMaze *maze = batch->maze;
+    const int rows = maze->rows;
+    const int columns = maze->columns;
+    const int cell_count = rows * columns;
+    const SimModel model = batch->model;
+    const int32_t max_ticks = batch->config.max_ticks;
+    const int32_t shelter_cell = maze->shelter_row < 0 ? -1 : maze->shelter_row * columns + maze->shelter_column;
+    const int32_t food_cell = maze->food_row < 0 ? -1 : maze->food_row * columns + maze->food_column;
+    const int32_t water_cell = maze->water_row < 0 ? -1 : maze->water_row * columns + maze->water_column;
+    const int32_t *restrict distance = batch->distance;
+    int32_t *restrict cells = batch->cells;
+
+    int32_t *restrict row = batch->row + first;
+    int32_t *restrict column = batch->column + first;
+    int32_t *restrict direction = batch->direction + first;
+    int32_t *restrict backtrack = batch->backtrack + first;
+    int32_t *restrict done = batch->done + first;
+    int32_t *restrict failed = batch->failed + first;
+    uint32_t *restrict rng = batch->rng + first;
+    uint32_t *restrict time_ms = batch->time_ms + first;
+    int32_t *restrict ticks = batch->ticks + first;
+    int32_t *restrict moved = batch->moved + first;
+    int32_t *restrict ir_front = batch->ir_front + first;
+    int32_t *restrict ir_right = batch->ir_right + first;
+    int32_t *restrict ir_left = batch->ir_left + first;
+    int32_t *restrict ir_rear = batch->ir_rear + first;
+    int32_t *restrict light = batch->light + first;
+    int32_t *restrict cells_visited = batch->cells_visited + first;
+    int32_t *restrict cells_driven = batch->cells_driven + first;
+    int32_t *restrict revisits = batch->revisits + first;
+    int32_t *restrict turns = batch->turns + first;
+    int32_t *restrict u_turns = batch->u_turns + first;
+    int32_t *restrict food_found = batch->food_found + first;
+    int32_t *restrict water_found = batch->water_found + first;
+    int32_t *restrict shelter_found = batch->shelter_found + first;
+    int32_t *restrict telemetry_bytes = batch->telemetry_bytes + first;
+
+#pragma GCC ivdep // the arrays never overlap
+    for (int i = 0; i < count; i++) // drive to the next line, a wall in front means the robot is stuck
+    {
+        int32_t alive = !done[i];
+        int32_t d = direction[i];
+        int32_t blocked = distance[(row[i] * columns + column[i]) * 4 + d] == 0;
+        int32_t m = alive & !blocked;
+
+        ticks[i] += alive;
+        failed[i] |= alive & blocked;
+        done[i] |= alive & blocked;
+        row[i] += m * sim_step_row(d);
+        column[i] += m * sim_step_column(d);
+        time_ms[i] += (uint32_t)m * (model.drive_ms + model.pause_ms);
+        cells_driven[i] += m;
+        moved[i] = m;
+    }
+
+#pragma GCC ivdep
+    for (int i = 0; i < count; i++) // raycasts are lookups into the distance table
+    {
+        int32_t base = (row[i] * columns + column[i]) * 4;
+        int32_t d = direction[i];
+        uint32_t state = rng[i];
+
+        ir_front[i] = ir_by_distance[distance[base + d]] * model.front_scale / 100 + sim_noise(&state, model.noise);
+        ir_right[i] = ir_by_distance[distance[base + ((d + 1) & 3)]] + model.side_bias + sim_noise(&state, model.noise);
+        ir_left[i] = ir_by_distance[distance[base + ((d + 3) & 3)]] - model.side_bias + sim_noise(&state, model.noise);
+        ir_rear[i] = ir_by_distance[distance[base + ((d + 2) & 3)]] * model.rear_scale / 100 + sim_noise(&state, model.noise);
+        light[i] = ((base >> 2) == shelter_cell ? SIM_LIGHT_DARK : SIM_LIGHT_OPEN) + sim_noise(&state, model.noise);
+        rng[i] = moved[i] ? state : rng[i];
+    }
+
+#pragma GCC ivdep // each robot only touches its own cells
+    for (int i = 0; i < count; i++) // set the walls and choose the next move
+    {
+        int32_t *own = cells + (size_t)(first + i) * cell_count;
+        int32_t m = moved[i];
+        int32_t d = direction[i];
+        int32_t cell = row[i] * columns + column[i];
+        int32_t state = own[cell];
+        int32_t seen = (state & SIM_CELL_VISITED) != 0;
+        int32_t arrived = m & ((state & SIM_CELL_INTERSECTION) != 0) & backtrack[i]; // cleared on the way in, see sim_robot_sense()
+
+        revisits[i] += m & seen;
+        cells_visited[i] += m & !seen;
+
+        int32_t seen_front = decide_wall(ir_front[i], model.wall_threshold);
+        int32_t seen_right = decide_wall(ir_right[i], model.wall_threshold);
+        int32_t seen_rear = decide_wall(ir_rear[i], model.wall_threshold);
+        int32_t seen_left = decide_wall(ir_left[i], model.wall_threshold);
+        int32_t walls = seen_front << d | seen_right << ((d + 1) & 3) | seen_rear << ((d + 2) & 3) | seen_left << ((d + 3) & 3);
+        int32_t updated = (state & ~SIM_CELL_WALLS) | walls | SIM_CELL_VISITED;
+        updated |= decide_intersection(seen_front, seen_right, seen_rear, seen_left) ? SIM_CELL_INTERSECTION : 0;
+        own[cell] = m ? updated : state;
+        int32_t dark = m & (light[i] <= model.light_threshold) & (shelter_found[i] == 0);
+        shelter_found[i] = dark ? (cell == shelter_cell ? 1 : -1) : shelter_found[i];
+
+        int32_t on_food = m & model.lines_counted & (cell == food_cell);
+        int32_t on_water = m & model.lines_counted & (cell == water_cell);
+        int32_t back = on_food | on_water;
+        food_found[i] += on_food;
+        water_found[i] += on_water;
+        row[i] -= back * sim_step_row(d);
+        column[i] -= back * sim_step_column(d);
+        time_ms[i] += (uint32_t)back * SIM_BACKOUT_MS;
+        int32_t telemetry = m * SIM_TELEMETRY_PAUSE + back * SIM_TELEMETRY_FOUND + arrived * SIM_TELEMETRY_INTERSECTION;
+        int32_t bt = (backtrack[i] & !arrived) | back;
+        cell = row[i] * columns + column[i];
+
+        state = own[cell];
+        int32_t front_wall = (state >> d) & 1;
+        int32_t right_wall = (state >> ((d + 1) & 3)) & 1;
+        int32_t left_wall = (state >> ((d + 3) & 3)) & 1;
+
+        int32_t left_row = row[i] + sim_step_row((d + 3) & 3);
+        int32_t left_column = column[i] + sim_step_column((d + 3) & 3);
+        int32_t left_inside = left_row >= 0 && left_row < rows && left_column >= 0 && left_column < columns;
+        int32_t left_visited = left_inside ? (own[left_inside ? left_row * columns + left_column : 0] & SIM_CELL_VISITED) != 0 : 1;
+        int32_t right_row = row[i] + sim_step_row((d + 1) & 3);
+        int32_t right_column = column[i] + sim_step_column((d + 1) & 3);
+        int32_t right_inside = right_row >= 0 && right_row < rows && right_column >= 0 && right_column < columns;
+        int32_t right_visited = right_inside ? (own[right_inside ? right_row * columns + right_column : 0] & SIM_CELL_VISITED) != 0 : 1;
+
+        int32_t turn = decide_turn(front_wall, left_wall, right_wall, left_visited, right_visited, bt);
+        turn = m ? turn : DECIDE_STRAIGHT;
+        int32_t dead_end = turn == DECIDE_AROUND;
+        int32_t turn_left = turn == DECIDE_LEFT;
+        int32_t turn_right = turn == DECIDE_RIGHT;
+
+        bt = m ? decide_backtrack(turn, bt) : bt; // the same either way, but gcc only vectorises the loop with the select
+        direction[i] = dead_end ? (d + 2) & 3 : turn_left ? (d + 3) & 3 : turn_right ? (d + 1) & 3 : d;
+        u_turns[i] += dead_end;
+        turns[i] += turn_left | turn_right;
+        time_ms[i] += (uint32_t)dead_end * SIM_TURN_180_MS + (uint32_t)(turn_left | turn_right) * SIM_TURN_90_MS;
+        int32_t tried = m & !dead_end & ((!left_wall) | (!right_wall));
+        int32_t skipped = tried & !(turn_left | turn_right);
+        int32_t cleared = m & ((state & SIM_CELL_INTERSECTION) != 0) & bt;
+        telemetry += (dead_end | tried) * SIM_TELEMETRY_MOVE + skipped * SIM_TELEMETRY_VISITED;
+        telemetry += (dead_end | turn_left | turn_right) * SIM_TELEMETRY_TURN + cleared * SIM_TELEMETRY_INTERSECTION;
+        telemetry_bytes[i] += telemetry;
+        backtrack[i] = (m & ((state & SIM_CELL_INTERSECTION) != 0)) ? 0 : bt;
+
+        int32_t finished = m & (cells_visited[i] == cell_count);
+        int32_t out_of_ticks = m & !finished & (ticks[i] >= max_ticks);
+        done[i] |= finished | out_of_ticks;
+        failed[i] |= out_of_ticks;
+    }
+
+#pragma GCC ivdep
+    for (int i = 0; i < count; i++) // turn away from a wall before driving, see sim_depart()
+    {
+        int32_t go = moved[i] & !done[i];
+        int32_t base = (row[i] * columns + column[i]) * 4;
+        int32_t d = direction[i];
+        uint32_t state = rng[i];
+
+        int32_t front = ir_by_distance[distance[base + d]] * model.front_scale / 100 + sim_noise(&state, model.noise);
+        int32_t rear = ir_by_distance[distance[base + ((d + 2) & 3)]] * model.rear_scale / 100 + sim_noise(&state, model.noise);
+        int32_t left = ir_by_distance[distance[base + ((d + 3) & 3)]] - model.side_bias + sim_noise(&state, model.noise);
+        int32_t right = ir_by_distance[distance[base + ((d + 1) & 3)]] + model.side_bias + sim_noise(&state, model.noise);
+        rng[i] = go ? state : rng[i];
+
+        int32_t turn = go ? decide_departure(front, rear, left, right, model.facing_wall_threshold) : DECIDE_STRAIGHT;
+        int32_t around = turn == DECIDE_AROUND;
+        int32_t away_right = turn == DECIDE_RIGHT;
+        int32_t away_left = turn == DECIDE_LEFT;
+
+        direction[i] = around ? (d + 2) & 3 : away_right ? (d + 1) & 3 : away_left ? (d + 3) & 3 : d;
+        u_turns[i] += around;
+        turns[i] += away_right | away_left;
+        time_ms[i] += (uint32_t)around * SIM_TURN_180_MS + (uint32_t)(away_right | away_left) * SIM_TURN_90_MS;
+        telemetry_bytes[i] += (around | away_right | away_left) * SIM_TELEMETRY_TURN + (away_right | away_left) * SIM_TELEMETRY_MOVE;
+    }
+}
+
+/**
+ * This function moves every robot in the batch one cell, stopped robots stay where they are
+ * @param *batch batch of robots to move
+ */
+void sim_batch_step(SimBatch *batch)
+{
+    sim_batch_step_range(batch, 0, batch->count);
+}
+
+/*
+ * Swaps two robots in the batch, keeping their cells with them
+ */
+static void sim_batch_swap(SimBatch *batch, int a, int b)
+{
+    int32_t **arrays[SIM_BATCH_ARRAYS];
+    int number_of_arrays = sim_batch_arrays(batch, arrays);
+    for (int n = 0; n < number_of_arrays; n++)
+    {
+        int32_t swap = (*arrays[n])[a];
+        (*arrays[n])[a] = (*arrays[n])[b];
+        (*arrays[n])[b] = swap;
+    }
+    uint32_t swap_rng = batch->rng[a];
+    batch->rng[a] = batch->rng[b];
+    batch->rng[b] = swap_rng;
+    uint32_t swap_time = batch->time_ms[a];
+    batch->time_ms[a] = batch->time_ms[b];
+    batch->time_ms[b] = swap_time;
+
+    size_t cell_count = (size_t)batch->maze->rows * batch->maze->columns;
+    int32_t *spare = batch->cells + (size_t)batch->count * cell_count;
+    memcpy(spare, batch->cells + a * cell_count, cell_count * sizeof(int32_t));
+    memcpy(batch->cells + a * cell_count, batch->cells + b * cell_count, cell_count * sizeof(int32_t));
+    memcpy(batch->cells + b * cell_count, spare, cell_count * sizeof(int32_t));
+}
+
+/**
+ * Steps the batch until every robot has stopped. Robots are run a tile at a time so their cells stay
+ * in cache, and stopped robots are moved to the back of the tile, afterwards slot i holds robot id[i]
+ * @return number of steps taken by the slowest tile
+ */
+int sim_batch_run(SimBatch *batch)
+{
+    int steps = 0;
+    for (int first = 0; first < batch->count; first += SIM_BATCH_TILE)
+    {
+        int active = batch->count - first < SIM_BATCH_TILE ? batch->count - first : SIM_BATCH_TILE;
+        int tile_steps = 0;
+        while (active > 0)
+        {
+            sim_batch_step_range(batch, first, active);
+            tile_steps++;
+
+            int stopped = 0;
+            for (int i = first; i < first + active; i++)
+            {
+                stopped += batch->done[i] != 0;
+            }
+            if (stopped * 8 > active || stopped == active) // compact once an eighth have stopped
+            {
+                int i = first;
+                while (i < first + active)
+                {
+                    if (batch->done[i])
+                    {
+                        active--;
+                        sim_batch_swap(batch, i, first + active);
+                    }
+                    else
+                    {
+                        i++;
+                    }
+                }
+            }
+        }
+        steps = tile_steps > steps ? tile_steps : steps;
+    }
+    return steps;
+}
+
+void sim_batch_free(SimBatch *batch)
+{
+    int32_t **arrays[SIM_BATCH_ARRAYS];
+    int number_of_arrays = sim_batch_arrays(batch, arrays);
+    for (int a = 0; a < number_of_arrays; a++)
+    {
+        free(*arrays[a]);
+    }
+    free(batch->rng);
+    free(batch->time_ms);
+    free(batch->cells);
+    memset(batch, 0, sizeof(*batch));
+}
+
+/**
+ * This function runs the same robots through the batch and through sim_robot_step() one at a time
+ * and compares every robot at the end
+ * @param *maze maze the robots run in
+ * @param *config params, noise and tick limit
+ * @param count number of robots
+ * @param seed run seed
+ * @return number of robots that don't match, -1 if out of memory
+ */
+int sim_batch_validate(const SimMaze *maze, const SimConfig *config, int count, uint32_t seed)
+{
+    SimBatch batch;
+    SimRobot *sim = malloc(sizeof(SimRobot));
+    if (sim == NULL || !sim_batch_init(&batch, maze, config, count, seed))
+    {
+        free(sim);
+        return -1;
+    }
+    sim_batch_run(&batch);
+
+    size_t cell_count = (size_t)maze->rows * maze->columns;
+    int mismatches = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sim_robot_init(sim, maze, config, sim_seed(seed, batch.id[i]));
+        sim_robot_run(sim, maze, config);
+
+        bool same = sim->row == batch.row[i] && sim->column == batch.column[i] &&
+                    sim->robot.direction == batch.direction[i] && sim->backtrack == (bool)batch.backtrack[i] &&
+                    sim->failed == (bool)batch.failed[i] && sim->rng == batch.rng[i] &&
+                    sim->time_ms == batch.time_ms[i] && sim->ticks == batch.ticks[i] &&
+                    sim->cells_visited == batch.cells_visited[i] && sim->cells_driven == batch.cells_driven[i] &&
+                    sim->revisits == batch.revisits[i] && sim->turns == batch.turns[i] &&
+                    sim->u_turns == batch.u_turns[i] && sim->food_found == batch.food_found[i] &&
+                    sim->water_found == batch.water_found[i] && sim->shelter_found == batch.shelter_found[i] &&
+                    sim->telemetry_bytes == batch.telemetry_bytes[i];
+        for (size_t c = 0; c < cell_count; c++)
+        {
+            same &= sim->cells[c] == batch.cells[i * cell_count + c];
+        }
+        mismatches += !same;
+    }
+
+    free(sim);
+    sim_batch_free(&batch);
+    return mismatches;
+}
@@ -0,0 +1,267 @@
+#ifndef MAZE_SIM
+#define MAZE_SIM
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mazeSolver.h"
+
+#define SIM_MAX_SIZE 32 // largest maze side the simulator handles
+#define SIM_MAX_CELLS (SIM_MAX_SIZE * SIM_MAX_SIZE)
+
+#define SIM_EDGE_COUNT(rows, columns) ((rows) * ((columns) + 1) + ((rows) + 1) * (columns))
+#define SIM_EDGE_BYTES(rows, columns) ((SIM_EDGE_COUNT(rows, columns) + 7) / 8)
+#define SIM_MAX_EDGE_BYTES SIM_EDGE_BYTES(SIM_MAX_SIZE, SIM_MAX_SIZE)
+
+#define SIM_IR_RANGE 3      // cells the ir sensors can see, further walls read as open
+#define SIM_LIGHT_OPEN 700  // light reading in a normal cell
+#define SIM_LIGHT_DARK 200  // light reading in the shelter
+
+#define SIM_TURN_90_MS 700  // Left(90) / Right(90)
+#define SIM_TURN_180_MS 1300
+#define SIM_BACKOUT_MS 600  // Backwards(150) out of a food or water cell
+
+// rough model of how the controller params change a run, all distances are ms x average motor speed
+#define SIM_CELL_TRAVEL 63750        // line to line, 1500ms at the hand picked speeds
+#define SIM_LINE_TO_CENTRE 19125     // big line to the middle of the cell, 450ms at the hand picked speeds
+#define SIM_EXTRA_LINE_GAP 10625     // big line to the first extra line of food and water
+#define SIM_EXTRA_LINE_SPACING 5525  // between extra lines
+#define SIM_OFFSET_GAIN 2            // percent the front reading grows for each percent of a cell past the middle
+#define SIM_MOTOR_TRIM 5             // left motor has to be this much faster for the robot to drive straight
+#define SIM_DRIFT_GAIN 4             // side reading bias for each unit the motors are off from the trim
+#define SIM_SMOOTH_SPEED 45          // average speed over which the robot starts to shake
+#define SIM_SPEED_NOISE 3            // extra sensor noise for each unit of speed over SIM_SMOOTH_SPEED
+#define SIM_SETTLE_MS 400            // time the robot rocks for after SetMotors(0, 0)
+#define SIM_ADJUST_MS 300            // time adjust_for_wall() needs to straighten up at the hand picked threshold
+#define SIM_ADJUST_RESIDUAL 8        // side bias left after adjusting is the adjust threshold over this
+
+// bytes handed to BTSendString() / BTSendNumber() by the controller, numbers are counted as three digits
+#define SIM_TELEMETRY_PAUSE 66        // row, column, walls from set_walls() and the cell origin from draw_cell()
+#define SIM_TELEMETRY_TURN 40         // "Robot is now facing ..." from set_direction()
+#define SIM_TELEMETRY_MOVE 20         // "Turning left", "Backtracking", "Beginning right" ...
+#define SIM_TELEMETRY_VISITED 30      // "Cell to the left is visited"
+#define SIM_TELEMETRY_FOUND 10        // "FOOD!" or "WATER!"
+#define SIM_TELEMETRY_INTERSECTION 30 // "Back at an intersection again"
+
+#define SIM_BATCH_ARRAYS 23 // signed per robot arrays in a SimBatch
+#define SIM_BATCH_TILE 64   // robots run together by sim_batch_run(), small enough for their cells to stay in cache
+
+#define SIM_CELL_WALLS 0x0f        // sensed walls, bit n is a wall in direction n (N - 0, E - 1, S - 2, W - 3)
+#define SIM_CELL_VISITED 0x10      // robot has been in the cell
+#define SIM_CELL_INTERSECTION 0x20 // more than two open paths, see set_intersection()
+
+/*
+ * Edge test of sim_search()
+ * @return the cell a robot gets to leaving cell in direction, -1 if it can't
+ */
+typedef int (*SimSearchNext)(void *context, int cell, int direction);
+
+/*
+ * Target test of sim_search(), called once for every cell the search reaches, nearest first
+ * @return true if the search stops at the cell
+ */
+typedef bool (*SimSearchTarget)(void *context, int cell);
+
+/*
+ * A maze as the simulator sees it. The walls are held as packed edge bits so that a maze
+ * can point straight at stored data, see sim_edge_index() for the layout.
+ */
+typedef struct SimMaze
+{
+    int rows;
+    int columns;
+    int start_row;
+    int start_column;
+    int start_direction;
+    int food_row; // -1 if there isn't any food
+    int food_column;
+    int water_row; // -1 if there isn't any water
+    int water_column;
+    int shelter_row; // -1 if there isn't a shelter
+    int shelter_column;
+    const uint8_t *edges; // packed wall bits
+} SimMaze;
+
+typedef struct SimConfig
+{
+    int noise;               // sensor readings are off by up to +/- noise
+    int max_ticks;           // robot gives up after this many cells
+    ControllerParams params; // thresholds and timings of the controller being simulated
+} SimConfig;
+
+/*
+ * What the controller params work out as in the simulator, see sim_model()
+ */
+typedef struct SimModel
+{
+    int drive_ms;         // line to line
+    int pause_ms;         // stopped in the cell
+    int front_scale;      // percent, the front reading grows when the robot stops past the middle
+    int rear_scale;       // percent
+    int side_bias;        // right reading goes up and the left one down when the robot drifts
+    int noise;            // sensor noise, including shaking from speed and from a short pause
+    bool lines_counted;   // extra lines of food and water are counted by stop_when_line_hit()
+    int wall_threshold;
+    int facing_wall_threshold;
+    int light_threshold;
+} SimModel;
+
+/*
+ * One simulated robot running the controller, the scalar reference for SimBatch.
+ */
+typedef struct SimRobot
+{
+    int row;
+    int column;
+    Robot robot;
+    bool backtrack;
+    bool done;   // stopped, either finished or stuck
+    bool failed; // drove into a wall or ran out of ticks
+    SimModel model;
+    uint32_t rng;
+    uint32_t time_ms; // simulated time since the start
+    int ticks;
+    int cells_visited;
+    int cells_driven;
+    int revisits;
+    int turns;
+    int u_turns;
+    int food_found;
+    int water_found;
+    int shelter_found; // 1 if the shelter was found, -1 if another cell was taken for it
+    int telemetry_bytes;          // sent over bluetooth, see SIM_TELEMETRY_
+    uint8_t cells[SIM_MAX_CELLS]; // SIM_CELL_ bits for each cell, indexed row * columns + column
+} SimRobot;
+
+/*
+ * Many robots on the same maze held as structure of arrays, every robot is moved one
+ * cell per step so the per robot loops stay branch free.
+ */
+typedef struct SimBatch
+{
+    int count;
+    const SimMaze *maze;
+    SimConfig config;
+    SimModel model;
+    int32_t distance[SIM_MAX_CELLS * 4]; // raycast from each cell in each direction
+
+    int32_t *id; // robot number, used for its seed
+    int32_t *row;
+    int32_t *column;
+    int32_t *direction;
+    int32_t *backtrack;
+    int32_t *done;
+    int32_t *failed;
+    uint32_t *rng;
+    uint32_t *time_ms;
+    int32_t *ticks;
+    int32_t *cells_visited;
+    int32_t *cells_driven;
+    int32_t *revisits;
+    int32_t *turns;
+    int32_t *u_turns;
+    int32_t *food_found;
+    int32_t *water_found;
+    int32_t *shelter_found;
+    int32_t *telemetry_bytes;
+
+    int32_t *moved; // scratch, set by the drive pass
+    int32_t *ir_front;
+    int32_t *ir_right;
+    int32_t *ir_left;
+    int32_t *ir_rear;
+    int32_t *light;
+
+    int32_t *cells; // SIM_CELL_ bits, robot i's cells start at i * rows * columns, int so they can be gathered
+} SimBatch;
+
+/**
+ * Gets the bit of a wall in the packed edges. Column edges come first, row by row, then the
+ * row edges, so neighbouring cells share the bit of the wall between them.
+ * @param rows, columns size of the maze
+ * @param row, column the cell
+ * @param direction N - 0 (column + 1), E - 1 (row + 1), S - 2, W - 3 as in cell_to_grid()
+ */
+static inline int sim_edge_index(int rows, int columns, int row, int column, int direction)
+{
+    switch (direction)
+    {
+    case 0:
+        return row * (columns + 1) + column + 1;
+    case 1:
+        return rows * (columns + 1) + (row + 1) * columns + column;
+    case 2:
+        return row * (columns + 1) + column;
+    default:
+        return rows * (columns + 1) + row * columns + column;
+    }
+}
+
+static inline bool sim_has_wall(const SimMaze *maze, int row, int column, int direction)
+{
+    int bit = sim_edge_index(maze->rows, maze->columns, row, column, direction);
+    return (maze->edges[bit >> 3] >> (bit & 7)) & 1;
+}
+
+/**
+ * Moves a row and column one cell in a direction, same as cell_to_grid()
+ * @param direction N - 0, E - 1, S - 2, W - 3
+ */
+static inline int sim_step_row(int direction)
+{
+    return (direction == 1) - (direction == 3);
+}
+
+static inline int sim_step_column(int direction)
+{
+    return (direction == 0) - (direction == 2);
+}
+
+/**
+ * xorshift, the random numbers of the simulator and every host program
+ * @param *state never 0, see sim_seed()
+ */
+static inline uint32_t sim_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Whether a run succeeded, the one test every host program uses: the robot visited every cell without getting
+ * stuck and found the food, water and shelter, those the maze has
+ * @param *maze maze the robot ran in
+ * @param failed, food_found, water_found, shelter_found as the run left them in its SimRobot or SimBatch
+ */
+static inline bool sim_succeeded(const SimMaze *maze, bool failed, int food_found, int water_found, int shelter_found)
+{
+    return !failed && (maze->food_row < 0 || food_found > 0) && (maze->water_row < 0 || water_found > 0) &&
+           (maze->shelter_row < 0 || shelter_found == 1);
+}
+
+void sim_set_wall(uint8_t *edges, int rows, int columns, int row, int column, int direction, bool wall);
+uint32_t sim_seed(uint32_t seed, int robot);
+void sim_model(SimModel *model, const SimConfig *config);
+double sim_seconds(void);
+int sim_search(int cell_count, int start, int heading, SimSearchNext next, SimSearchTarget target, void *context,
+               int *came_from);
+int sim_search_path(int columns, const int *came_from, int start, int target, int *path);
+
+void sim_robot_init(SimRobot *sim, const SimMaze *maze, const SimConfig *config, uint32_t seed);
+int sim_robot_look(SimRobot *sim, const SimMaze *maze);
+bool sim_robot_sense(SimRobot *sim, const SimMaze *maze);
+void sim_robot_decide(SimRobot *sim, const SimMaze *maze, const SimConfig *config, int planned);
+void sim_robot_step(SimRobot *sim, const SimMaze *maze, const SimConfig *config);
+void sim_robot_run(SimRobot *sim, const SimMaze *maze, const SimConfig *config);
+
+bool sim_batch_init(SimBatch *batch, const SimMaze *maze, const SimConfig *config, int count, uint32_t seed);
+void sim_batch_step(SimBatch *batch);
+int sim_batch_run(SimBatch *batch);
+void sim_batch_free(SimBatch *batch);
+int sim_batch_validate(const SimMaze *maze, const SimConfig *config, int count, uint32_t seed);
+
+#endif
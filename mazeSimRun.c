@@ -0,0 +1,70 @@
+#include "mazeGen.h"
+#include "mazeSim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Host program that checks the batch simulator against the scalar one and compares their speed.
+ * usage: mazeSimRun [rows] [columns] [robots] [noise] [seed]
+ */
+
+int main(int argc, char **argv)
+{
+    int rows = argc > 1 ? atoi(argv[1]) : 5;
+    int columns = argc > 2 ? atoi(argv[2]) : 5;
+    int robots = argc > 3 ? atoi(argv[3]) : 1000;
+    SimConfig config = {argc > 4 ? atoi(argv[4]) : 20, 0, CONTROLLER_PARAMS_DEFAULT};
+    uint32_t seed = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 1;
+
+    if (rows < 1 || rows > SIM_MAX_SIZE || columns < 1 || columns > SIM_MAX_SIZE || robots < 1)
+    {
+        fprintf(stderr, "rows and columns go from 1 to %d\n", SIM_MAX_SIZE);
+        return 1;
+    }
+    config.max_ticks = rows * columns * 8;
+
+    static uint8_t edges[SIM_MAX_EDGE_BYTES];
+    SimMaze maze;
+    generate_perfect_maze(&maze, edges, rows, columns, seed);
+
+    int mismatches = sim_batch_validate(&maze, &config, robots, seed);
+    printf("validate: %d of %d robots differ\n", mismatches, robots);
+
+    SimRobot *sim = malloc(sizeof(SimRobot));
+    if (sim == NULL)
+    {
+        return 1;
+    }
+    long scalar_ticks = 0;
+    int finished = 0;
+    double start = sim_seconds();
+    for (int i = 0; i < robots; i++)
+    {
+        sim_robot_init(sim, &maze, &config, sim_seed(seed, i));
+        sim_robot_run(sim, &maze, &config);
+        scalar_ticks += sim->ticks;
+        finished += !sim->failed;
+    }
+    double scalar_seconds = sim_seconds() - start;
+    free(sim);
+
+    SimBatch batch;
+    start = sim_seconds();
+    if (!sim_batch_init(&batch, &maze, &config, robots, seed))
+    {
+        return 1;
+    }
+    sim_batch_run(&batch);
+    double batch_seconds = sim_seconds() - start;
+    long batch_ticks = 0;
+    for (int i = 0; i < robots; i++)
+    {
+        batch_ticks += batch.ticks[i];
+    }
+    sim_batch_free(&batch);
+
+    printf("finished: %d of %d robots\n", finished, robots);
+    printf("scalar: %.3g robot-ticks/s\n", scalar_ticks / scalar_seconds);
+    printf("batch:  %.3g robot-ticks/s\n", batch_ticks / batch_seconds);
+    return mismatches != 0;
+}
@@ -1,11 +1,19 @@
+#include "mazeDecide.h"
 #include "mazeMapper.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
-#define MOTOR_SPEED_LEFT 45
-#define MOTOR_SPEED_RIGHT 40
-#define OBSTACLE_SENSOR_THRESHOLD 200
-#define LIGHT_SENSOR_THRESHOLD 400
+#ifdef MAZE_OFFLOAD
+#include "mazeLink.h"
+#endif
+
+ControllerParams params = CONTROLLER_PARAMS_DEFAULT; // thresholds and timings, see mazeParams.h
+
+#ifdef MAZE_OFFLOAD
+PlanLink *plan_link = NULL; // link to the host planner, set up by the board code, every move is decided onboard while NULL
+LinkRobot link_robot;       // robot side of plan_link, see start_link()
+bool link_started = false;
+#endif
 
 void finished_maze() // plays an arpeggiated DMin7
 {
@@ -54,6 +62,7 @@ void initialise_maze(Maze *maze)
             maze->cells[r][c].walls.left = false;
             maze->cells[r][c].walls.right = false;
             maze->cells[r][c].walls.rear = false;
+            maze->cells[r][c].walls_direction = 0;
         }
     }
 }
@@ -118,10 +127,10 @@ void adjust_for_wall()
     int right = ReadIR(IR_RIGHT);
     int left = ReadIR(IR_LEFT);
 
-    const int threshold = 250;
+    const int threshold = params.adjust_threshold;
 
     unsigned long start_time = ClockMS();
-    while ((front < 500 || front_right < front_left + threshold || front_left < front_right + threshold || left < right + threshold / 2 || right < left + threshold / 2) && (ClockMS() - start_time < 500))
+    while ((front < 500 || front_right < front_left + threshold || front_left < front_right + threshold || left < right + threshold / 2 || right < left + threshold / 2) && (ClockMS() - start_time < (unsigned long)params.adjust_timeout_ms))
     {
         if (front_right + threshold < front_left)
         {
@@ -158,10 +167,10 @@ void adjust_for_wall()
  */
 void set_walls(int front, int right, int left, int rear, Walls *walls)
 {
-    walls->front = (front > OBSTACLE_SENSOR_THRESHOLD / 5); // sets the front wall based on if front > obstacle threashold as it returns either true or false
-    walls->right = (right > OBSTACLE_SENSOR_THRESHOLD / 5);
-    walls->left = (left > OBSTACLE_SENSOR_THRESHOLD / 5);
-    walls->rear = (rear > OBSTACLE_SENSOR_THRESHOLD / 5);
+    walls->front = decide_wall(front, params.wall_threshold); // sets the front wall based on if front > obstacle threashold as it returns either true or false
+    walls->right = decide_wall(right, params.wall_threshold);
+    walls->left = decide_wall(left, params.wall_threshold);
+    walls->rear = decide_wall(rear, params.wall_threshold);
 
     if (walls->front == true)
     {
@@ -303,27 +312,26 @@ bool stop_when_line_hit(unsigned long *pause_start_time, int *rows, int *columns
 
     if (!motors_started && !stopping) // starts the motors at the beginning of the program, as after it needs to see a line to continue forward
     {
-        if (ReadIR(IR_FRONT) > OBSTACLE_SENSOR_THRESHOLD / 4) // specific edge case where robot starts facing a wall
+        switch (decide_departure(ReadIR(IR_FRONT), ReadIR(IR_REAR), ReadIR(IR_LEFT), ReadIR(IR_RIGHT), params.facing_wall_threshold)) // specific edge case where robot starts facing a wall
         {
-            if (ReadIR(IR_REAR) < 30)
-            {
-                Right(180); // turns around
-                set_direction(robot, 3);
-            }
-            else if (ReadIR(IR_LEFT) > 50)
-            {
-                BTSendString("Beginning right\n", 20);
-                Right(90);
-                set_direction(robot, 1);
-            }
-            else if (ReadIR(IR_RIGHT) > 50)
-            {
-                BTSendString("Beginning left\n", 20);
-                Left(90);
-                set_direction(robot, 2);
-            }
+        case DECIDE_AROUND:
+            Right(180); // turns around
+            set_direction(robot, 3);
+            break;
+        case DECIDE_RIGHT:
+            BTSendString("Beginning right\n", 20);
+            Right(90);
+            set_direction(robot, 1);
+            break;
+        case DECIDE_LEFT:
+            BTSendString("Beginning left\n", 20);
+            Left(90);
+            set_direction(robot, 2);
+            break;
+        default:
+            break;
         }
-        SetMotors(MOTOR_SPEED_LEFT, MOTOR_SPEED_RIGHT); // motor then starts
+        SetMotors(params.motor_speed_left, params.motor_speed_right); // motor then starts
         motors_started = 1;                             // started flag now positive
     }
 
@@ -334,7 +342,7 @@ bool stop_when_line_hit(unsigned long *pause_start_time, int *rows, int *columns
         line_detect_time = ClockMS();
     }
 
-    if (big_line_detected && line_detect_time != 0 && ClockMS() - line_detect_time > 200 && !stopping) // if after 200 ms since the big line has been seen
+    if (big_line_detected && line_detect_time != 0 && ClockMS() - line_detect_time > (unsigned long)params.extra_line_delay_ms && !stopping) // if after the extra line delay since the big line has been seen
     {
         if (ReadLine(0) < 100 && ReadLine(1) < 100) // check line sensors
         {
@@ -355,12 +363,12 @@ bool stop_when_line_hit(unsigned long *pause_start_time, int *rows, int *columns
         }
     }
 
-    if (another_line_detected && (ClockMS() - another_line_detect_time > 100)) // if another line hasn't been detected in more than 100 ms reset
+    if (another_line_detected && (ClockMS() - another_line_detect_time > (unsigned long)params.extra_line_reset_ms)) // if another line hasn't been detected in more than the reset time reset
     {
         another_line_detected = false;
     }
 
-    if (line_detect_time != 0 && ClockMS() - line_detect_time >= 450 && !stopping) // pauses the robot after a line has been detected
+    if (line_detect_time != 0 && ClockMS() - line_detect_time >= (unsigned long)params.line_stop_ms && !stopping) // pauses the robot after a line has been detected
     {
         *pause_start_time = ClockMS(); // gets the time when the pause started
         SetMotors(0, 0);               // actually stops the robot
@@ -369,12 +377,12 @@ bool stop_when_line_hit(unsigned long *pause_start_time, int *rows, int *columns
         line_detect_time = 0;
     }
 
-    if (stopping && ClockMS() - *pause_start_time < 1250) // whilst the robot has been stopped adjust itself
+    if (stopping && ClockMS() - *pause_start_time < (unsigned long)params.pause_ms) // whilst the robot has been stopped adjust itself
     {
         adjust_for_wall();
     }
 
-    if (stopping && ClockMS() - *pause_start_time >= 1250) // checks if robot has been stopped for a long enough time i.e. 1250ms
+    if (stopping && ClockMS() - *pause_start_time >= (unsigned long)params.pause_ms) // checks if robot has been stopped for a long enough time i.e. params.pause_ms
     {
         *number_of_seen_lines = number_of_lines - 1; // updates the lines after the pause;
         stopping = 0;
@@ -401,54 +409,173 @@ bool stop_when_line_hit(unsigned long *pause_start_time, int *rows, int *columns
 void wall_based_movement(Maze maze, int row, int column, bool *backtrack, Robot *robot)
 {
     Cell cell = maze.cells[row][column];
-    int next_row = 0;
-    int next_column = 0;
+    bool left_visited = false;
+    bool right_visited = false;
+
+    if (!cell.walls.left) // only an open side is looked at, so the next cell is inside the maze
+    {
+        int next_row = row;
+        int next_column = column;
+        cell_to_grid((robot->direction + 3) % 4, &next_row, &next_column); // calculate next cell as if robot turned left
+        left_visited = maze.cells[next_row][next_column].visited;
+    }
+    if (!cell.walls.right)
+    {
+        int next_row = row;
+        int next_column = column;
+        cell_to_grid((robot->direction + 1) % 4, &next_row, &next_column); // calculate next cell as if robot turned right
+        right_visited = maze.cells[next_row][next_column].visited;
+    }
 
-    if (cell.walls.front && cell.walls.left && cell.walls.right)
+    int turn = decide_turn(cell.walls.front, cell.walls.left, cell.walls.right, left_visited, right_visited, *backtrack);
+    *backtrack = decide_backtrack(turn, *backtrack); // backtrack enabled at a dead end
+    if (turn == DECIDE_AROUND)
     {
-        (*backtrack) = true; // backtrack enabled
         BTSendString("Backtracking", 20);
         Left(180);
         set_direction(robot, 3); // backtracking turn
     }
-    else
+    else if (!cell.walls.left) // if no walls on the left then turn left
     {
-        if (!cell.walls.left) // if no walls on the left then turn left
+        BTSendString("Turning left\n", 20);
+        if (turn == DECIDE_LEFT)
         {
-            BTSendString("Turning left\n", 20);
-            next_row = row;
-            next_column = column;
-            cell_to_grid((robot->direction + 3) % 4, &next_row, &next_column); // calculate next cell as if robot turned left
-            if (!maze.cells[next_row][next_column].visited || *backtrack)
-            {
-                Left(90);
-                set_direction(robot, 2); // left turn
-            }
-            else
-            {
-                BTSendString("Cell to the left is visited\n", 30);
-            }
+            Left(90);
+            set_direction(robot, 2); // left turn
         }
-        else if (!cell.walls.right) // if there are no walls on the right then turn right
+        else
         {
-            BTSendString("Turning right\n", 20);
-            next_row = row;
-            next_column = column;
-            cell_to_grid((robot->direction + 1) % 4, &next_row, &next_column); // calculate next cell as if robot turned right
-            if (!maze.cells[next_row][next_column].visited || *backtrack)
-            {
-                Right(90);
-                set_direction(robot, 1); // right turn
-            }
-            else
-            {
-                BTSendString("Cell to the right is visited\n", 30);
-            }
+            BTSendString("Cell to the left is visited\n", 30);
+        }
+    }
+    else if (!cell.walls.right) // if there are no walls on the right then turn right
+    {
+        BTSendString("Turning right\n", 20);
+        if (turn == DECIDE_RIGHT)
+        {
+            Right(90);
+            set_direction(robot, 1); // right turn
+        }
+        else
+        {
+            BTSendString("Cell to the right is visited\n", 30);
         }
     }
     ResetEncoders(); // resets encoders after a move
 }
 
+#ifdef MAZE_OFFLOAD
+/**
+ * Turns the walls of a cell, which are kept relative to the way the robot faced when it read them, into wall
+ * bits that point the same way whichever way the robot faces now (bit n is a wall in direction n)
+ * @param cell cell with its walls read
+ */
+int absolute_walls(Cell cell)
+{
+    int direction = cell.walls_direction;
+    return cell.walls.front << direction | cell.walls.right << (direction + 1) % 4 | cell.walls.rear << (direction + 2) % 4 |
+           cell.walls.left << (direction + 3) % 4;
+}
+
+/**
+ * This function sets up the robot side of the link the first time it is used
+ */
+void start_link()
+{
+    if (!link_started)
+    {
+        link_robot_init(&link_robot);
+        link_started = true;
+    }
+}
+
+/**
+ * This function reads the walls of the start cell and sends them to the host planner before the first move,
+ * so the planner knows the cell has been visited and never sends the robot back to it
+ * @param *maze pointer to the maze, the walls of the start cell are set
+ * @param row, column the start cell
+ * @param *robot pointer to the robot
+ */
+void observe_start(Maze *maze, int row, int column, Robot *robot)
+{
+    start_link();
+
+    int front = ReadIR(IR_FRONT);
+    int left = ReadIR(IR_LEFT);
+    int right = ReadIR(IR_RIGHT);
+    int rear = ReadIR(IR_REAR);
+    set_walls(front, right, left, rear, &maze->cells[row][column].walls);
+    maze->cells[row][column].walls_direction = robot->direction;
+
+    LinkObservation observation;
+    observation.row = row;
+    observation.column = column;
+    observation.direction = robot->direction;
+    observation.walls = absolute_walls(maze->cells[row][column]);
+    link_robot_observe(&link_robot, plan_link, &observation, row, column);
+}
+
+/**
+ * This function sends what the robot saw in the cell to the host planner and takes the planned move if it
+ * arrives within LINK_WAIT_MS, otherwise wall_based_movement() decides as usual
+ * @param maze maze with the walls just read
+ * @param row, column cell the robot is in, one back from where the walls were read if it backed out of food or water
+ * @param number_of_seen_lines lines seen going into the cell, 2 is food and 3 is water
+ * @param *robot pointer to the robot, the direction is updated if it turns
+ * @return true if the robot took a planned move
+ */
+bool planned_movement(Maze maze, int row, int column, int number_of_seen_lines, Robot *robot)
+{
+    start_link();
+
+    LinkObservation observation;
+    observation.row = row;
+    observation.column = column;
+    observation.direction = robot->direction;
+    if (number_of_seen_lines == 2 || number_of_seen_lines == 3) // the walls were read in the food or water cell
+    {
+        cell_to_grid(robot->direction, &observation.row, &observation.column);
+    }
+    observation.walls = absolute_walls(maze.cells[observation.row][observation.column]);
+    observation.walls |= number_of_seen_lines == 2 ? LINK_FOUND_FOOD : 0;
+    observation.walls |= number_of_seen_lines == 3 ? LINK_FOUND_WATER : 0;
+    link_robot_observe(&link_robot, plan_link, &observation, row, column);
+
+    int walls = absolute_walls(maze.cells[row][column]); // read when it was last in the cell, before any turn since
+    unsigned long wait_start_time = ClockMS();
+    int move;
+    do
+    {
+        link_robot_poll(&link_robot, plan_link);
+        move = link_robot_move(&link_robot, walls);
+    } while (move < 0 && !link_robot.explored && (long)(ClockMS() - wait_start_time) < LINK_WAIT_MS);
+
+    if (move < 0)
+    {
+        return false;
+    }
+    switch ((move - robot->direction + 4) % 4) // how far right the planned direction is
+    {
+    case 1:
+        Right(90);
+        set_direction(robot, 1);
+        break;
+    case 2:
+        Left(180);
+        set_direction(robot, 3);
+        break;
+    case 3:
+        Left(90);
+        set_direction(robot, 2);
+        break;
+    default:
+        break;
+    }
+    ResetEncoders();
+    return true;
+}
+#endif
+
 /**
  * This function sets the current cell as an intersection based on the amount of empty spaces surrounding the cell. If there is
  * more than two then the cell is an intersection, used for stopping backtracking in traverse_maze()
@@ -458,11 +585,7 @@ void set_intersection(Cell *cell)
 {
     if (!cell->is_intersection)
     {
-        int open_paths = !cell->walls.front + !cell->walls.left + !cell->walls.right + !cell->walls.rear; // gets number of open paths
-        if (open_paths > 2)                                                                               // if it more than 2 then it indicates an intersection
-        {
-            cell->is_intersection = true;
-        }
+        cell->is_intersection = decide_intersection(cell->walls.front, cell->walls.right, cell->walls.rear, cell->walls.left); // more than 2 open paths
     }
 }
 
@@ -517,10 +640,11 @@ void traverse_maze(unsigned long *pause_start_time, Maze *maze, bool *backtrack,
         int rear = ReadIR(IR_REAR);
 
         set_walls(front, right, left, rear, &maze->cells[*rows][*columns].walls); // sets walls of cell
+        maze->cells[*rows][*columns].walls_direction = robot->direction;
 
         set_intersection(&maze->cells[*rows][*columns]); // declares if cell is an intersection
 
-        if (ReadLight() <= LIGHT_SENSOR_THRESHOLD && (maze->shelter_x == -1 && maze->shelter_y == -1)) // shelter is undiscovered
+        if (ReadLight() <= params.light_threshold && (maze->shelter_x == -1 && maze->shelter_y == -1)) // shelter is undiscovered
         {
             maze->shelter_x = *columns;
             maze->shelter_y = *rows;
@@ -558,6 +682,12 @@ void traverse_maze(unsigned long *pause_start_time, Maze *maze, bool *backtrack,
             draw_special_cell(*maze, *columns, *rows, 2); // draws a shelter
         }
 
+#ifdef MAZE_OFFLOAD
+        if (plan_link != NULL && planned_movement(*maze, *rows, *columns, number_of_seen_lines, robot))
+        {
+            return;
+        }
+#endif
         wall_based_movement(*maze, *rows, *columns, backtrack, robot); // updates the movement of the cell
     }
 }
@@ -586,6 +716,13 @@ int main(void)
 
     bool backtrack = false;
 
+#ifdef MAZE_OFFLOAD
+    if (plan_link != NULL)
+    {
+        observe_start(&maze, rows, columns, &robot);
+    }
+#endif
+
     while (1)
     {
         if (num_of_cells == 25)
@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 
+#include "mazeParams.h"
+
 typedef struct Robot
 {
     int direction; // N - 0, E - 1, S - 2, W - 3;
@@ -22,6 +24,7 @@ typedef struct Cell
     int x;                // cell x
     int y;                // cell y
     Walls walls;          // walls surrounding the walls
+    int walls_direction;  // direction the robot was facing when the walls were read, they are relative to it
     bool is_intersection; // if the cell is an intersection
 } Cell;
 
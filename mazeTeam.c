@@ -0,0 +1,394 @@
+#include "mazeTeam.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+/*
+ * One robot of a team run and its thread
+ */
+typedef struct TeamRobot
+{
+    struct TeamRun *run;
+    int id;
+    SimRobot sim;
+    int claim; // cell the robot is heading for, -1 if it hasn't claimed one
+    int revisits;
+    int claims_lost;
+    pthread_t thread;
+} TeamRobot;
+
+/*
+ * Everything the threads of a team run share. The robots move in simulated time order, a round at a time between
+ * two barriers: the robots within TEAM_SLOT_MS of the one furthest behind drive a cell and publish what they saw,
+ * then choose their next move from the map, while the robots further ahead wait for the others to catch up.
+ */
+typedef struct TeamRun
+{
+    const SimMaze *maze;
+    const SimConfig *config;
+    int robots;
+    TeamMap map;
+    pthread_barrier_t barrier;
+    atomic_int go;      // 1 once every thread has started, -1 if one couldn't be
+    atomic_int stopped; // robots that have finished or got stuck
+    uint32_t next_ms[TEAM_MAX_ROBOTS]; // simulated time of each robot at the end of the last round, UINT32_MAX once
+                                       // it has stopped, only written while choosing so it can be read while driving
+    TeamRobot members[TEAM_MAX_ROBOTS];
+} TeamRun;
+
+/*
+ * What team_choose() hands to sim_search()
+ */
+typedef struct TeamSearch
+{
+    TeamMap *map;
+    int start;
+    uint8_t mine; // claim value of the robot, its number plus one
+    int *claims_lost;
+} TeamSearch;
+
+static inline void team_set_bit(_Atomic uint8_t *bits, int bit)
+{
+    atomic_fetch_or_explicit(&bits[bit >> 3], (uint8_t)(1 << (bit & 7)), memory_order_release);
+}
+
+static inline void team_clear_bit(_Atomic uint8_t *bits, int bit)
+{
+    atomic_fetch_and_explicit(&bits[bit >> 3], (uint8_t)~(1 << (bit & 7)), memory_order_release);
+}
+
+static inline bool team_get_bit(_Atomic uint8_t *bits, int bit)
+{
+    return (atomic_load_explicit(&bits[bit >> 3], memory_order_acquire) >> (bit & 7)) & 1;
+}
+
+/**
+ * This function sets up an empty shared map
+ * @param *map map to set up
+ * @param rows, columns size of the maze, up to SIM_MAX_SIZE
+ */
+void team_map_init(TeamMap *map, int rows, int columns)
+{
+    map->rows = rows;
+    map->columns = columns;
+    for (int i = 0; i < SIM_MAX_EDGE_BYTES; i++)
+    {
+        atomic_init(&map->known[i], 0);
+        atomic_init(&map->walls[i], 0);
+    }
+    for (int i = 0; i < SIM_MAX_CELLS; i++)
+    {
+        atomic_init(&map->cells[i], 0);
+        atomic_init(&map->claims[i], 0);
+        atomic_init(&map->visit_ms[i], UINT32_MAX);
+    }
+    atomic_init(&map->cells_visited, 0);
+    atomic_init(&map->complete, false);
+}
+
+/**
+ * Puts the walls a robot read in a cell on the map, over whatever was read of its edges before, and marks the
+ * cell visited
+ * @param *map shared map
+ * @param row, column cell the walls were read in
+ * @param walls wall bits of the cell as set_walls() saw them, bit n is a wall in direction n
+ * @param blocked the cell is food or water
+ * @param time_ms simulated time of the robot, kept if no robot was in the cell earlier
+ * @return true if no robot had been in the cell before
+ */
+bool team_publish(TeamMap *map, int row, int column, int walls, bool blocked, uint32_t time_ms)
+{
+    int cell = row * map->columns + column;
+    uint32_t first = atomic_load(&map->visit_ms[cell]);
+    while (time_ms < first && !atomic_compare_exchange_weak(&map->visit_ms[cell], &first, time_ms))
+    {
+        // first is reloaded by the failed exchange, robots of the same round can arrive in any order
+    }
+
+    for (int direction = 0; direction < 4; direction++)
+    {
+        int bit = sim_edge_index(map->rows, map->columns, row, column, direction);
+        if ((walls >> direction) & 1) // before the known bit, see TeamMap
+        {
+            team_set_bit(map->walls, bit);
+        }
+        else
+        {
+            team_clear_bit(map->walls, bit);
+        }
+        team_set_bit(map->known, bit);
+    }
+
+    uint8_t flags = TEAM_CELL_VISITED | (blocked ? TEAM_CELL_BLOCKED : 0);
+    uint8_t before = atomic_fetch_or(&map->cells[cell], flags);
+    if (before & TEAM_CELL_VISITED)
+    {
+        return false;
+    }
+    if (atomic_fetch_add(&map->cells_visited, 1) + 1 == map->rows * map->columns)
+    {
+        atomic_store(&map->complete, true);
+    }
+    return true;
+}
+
+/*
+ * Whether the map says a robot can drive from a cell in a direction
+ * @param guess what to say if nobody has seen the edge
+ * @return the cell it gets to, -1 if it can't
+ */
+static int team_next(TeamMap *map, int cell, int direction, bool guess)
+{
+    int row = cell / map->columns + sim_step_row(direction);
+    int column = cell % map->columns + sim_step_column(direction);
+    if (row < 0 || row >= map->rows || column < 0 || column >= map->columns)
+    {
+        return -1;
+    }
+    int bit = sim_edge_index(map->rows, map->columns, cell / map->columns, cell % map->columns, direction);
+    bool open = team_get_bit(map->known, bit) ? !team_get_bit(map->walls, bit) : guess;
+    int next = row * map->columns + column;
+    return open && !(atomic_load(&map->cells[next]) & TEAM_CELL_BLOCKED) ? next : -1;
+}
+
+static int team_search_next(void *context, int cell, int direction)
+{
+    const TeamSearch *search = context;
+    return team_next(search->map, cell, direction, cell == search->start); // the start cell is never seen, guess its way out
+}
+
+/*
+ * The search stops at the nearest cell nobody has been in, once the robot holds its claim
+ */
+static bool team_search_target(void *context, int cell)
+{
+    const TeamSearch *search = context;
+    if (atomic_load(&search->map->cells[cell]) & TEAM_CELL_VISITED)
+    {
+        return false;
+    }
+    uint8_t owner = atomic_load(&search->map->claims[cell]);
+    if (owner == 0 && !atomic_compare_exchange_strong(&search->map->claims[cell], &owner, search->mine))
+    {
+        (*search->claims_lost)++; // claimed by another robot since the load, owner is now that robot
+    }
+    return owner == 0 || owner == search->mine;
+}
+
+/**
+ * Finds the nearest unvisited cell no other robot has claimed, claims it and gives the first move towards it.
+ * Cells claimed by another robot are left to it, and losing a claim to another robot in the meantime sends
+ * the search on to the next cell.
+ * @param *map shared map
+ * @param robot number of the robot
+ * @param *claim cell the robot has claimed, -1 for none, swapped for the new one and the old claim let go
+ * @param row, column cell the robot is in
+ * @param direction way the robot is facing, straight on is tried first
+ * @param *claims_lost counts claims another robot got to first
+ * @return direction to leave the cell in, -1 if there is nothing left to claim and the controller has to decide
+ */
+int team_choose(TeamMap *map, int robot, int *claim, int row, int column, int direction, int *claims_lost)
+{
+    int start = row * map->columns + column;
+    int came_from[SIM_MAX_CELLS];
+    uint8_t mine = (uint8_t)(robot + 1);
+    TeamSearch search = {map, start, mine, claims_lost};
+    int target = sim_search(map->rows * map->columns, start, direction, team_search_next, team_search_target, &search,
+                            came_from);
+
+    if (*claim >= 0 && *claim != target) // let go of the old claim, unless someone else has it now
+    {
+        uint8_t owner = mine;
+        atomic_compare_exchange_strong(&map->claims[*claim], &owner, 0);
+    }
+    *claim = target;
+    if (target < 0)
+    {
+        return -1;
+    }
+
+    int path[SIM_MAX_CELLS];
+    sim_search_path(map->columns, came_from, start, target, path);
+    return path[0];
+}
+
+/*
+ * Thread of one robot, drives until the map is complete or every robot has stopped
+ */
+static void *team_robot_thread(void *argument)
+{
+    TeamRobot *member = argument;
+    TeamRun *run = member->run;
+    const SimMaze *maze = run->maze;
+    SimRobot *sim = &member->sim;
+    bool active = true;
+    int found = 0;
+
+    int go;
+    while ((go = atomic_load(&run->go)) == 0)
+    {
+        sched_yield();
+    }
+    if (go < 0)
+    {
+        return NULL;
+    }
+
+    while (1)
+    {
+        uint32_t slot_end = UINT32_MAX; // robots at or past it wait this round out
+        for (int i = 0; i < run->robots; i++)
+        {
+            if (run->next_ms[i] < slot_end - TEAM_SLOT_MS)
+            {
+                slot_end = run->next_ms[i] + TEAM_SLOT_MS;
+            }
+        }
+        bool moving = active && sim->time_ms < slot_end;
+
+        if (moving)
+        {
+            active = sim_robot_sense(sim, maze);
+            if (!active)
+            {
+                atomic_fetch_add(&run->stopped, 1);
+                if (member->claim >= 0) // let the others have the cell it was heading for
+                {
+                    uint8_t owner = (uint8_t)(member->id + 1);
+                    atomic_compare_exchange_strong(&run->map.claims[member->claim], &owner, 0);
+                    member->claim = -1;
+                }
+            }
+            else
+            {
+                bool backed_out = sim->food_found + sim->water_found != found; // the walls were read one cell on
+                found = sim->food_found + sim->water_found;
+                int direction = sim->robot.direction;
+                int row = sim->row + (backed_out ? sim_step_row(direction) : 0);
+                int column = sim->column + (backed_out ? sim_step_column(direction) : 0);
+                int walls = sim->cells[row * maze->columns + column] & SIM_CELL_WALLS;
+                if (!team_publish(&run->map, row, column, walls, backed_out, sim->time_ms))
+                {
+                    member->revisits++;
+                }
+            }
+        }
+        pthread_barrier_wait(&run->barrier);
+        // nothing writes these until every robot is past the next barrier, so they all stop on the same tick
+        if (atomic_load(&run->map.complete) || atomic_load(&run->stopped) == run->robots)
+        {
+            break;
+        }
+        moving &= active;
+        if (moving)
+        {
+            for (int direction = 0; direction < 4; direction++) // let the controller see cells the others have been in
+            {
+                int row = sim->row + sim_step_row(direction);
+                int column = sim->column + sim_step_column(direction);
+                if (row >= 0 && row < maze->rows && column >= 0 && column < maze->columns &&
+                    (atomic_load(&run->map.cells[row * maze->columns + column]) & TEAM_CELL_VISITED))
+                {
+                    sim->cells[row * maze->columns + column] |= SIM_CELL_VISITED;
+                }
+            }
+            int move = team_choose(&run->map, member->id, &member->claim, sim->row, sim->column, sim->robot.direction,
+                                   &member->claims_lost);
+            sim_robot_decide(sim, maze, run->config, move); // if this stops the robot, sensing next turn counts it
+        }
+        run->next_ms[member->id] = active ? sim->time_ms : UINT32_MAX;
+        pthread_barrier_wait(&run->barrier);
+    }
+    return NULL;
+}
+
+/**
+ * This function runs a team of robots from the start of a maze, each on its own thread, sharing one map
+ * @param *maze maze the robots run in
+ * @param *config params, noise and tick limit of every robot
+ * @param robots number of robots, up to TEAM_MAX_ROBOTS
+ * @param seed run seed, robot i uses sim_seed(seed, i)
+ * @param *result filled in with how the team did
+ * @return false if the threads couldn't be started
+ */
+bool team_run(const SimMaze *maze, const SimConfig *config, int robots, uint32_t seed, TeamResult *result)
+{
+    TeamRun *run = malloc(sizeof(TeamRun));
+    if (run == NULL || robots < 1 || robots > TEAM_MAX_ROBOTS)
+    {
+        free(run);
+        return false;
+    }
+    run->maze = maze;
+    run->config = config;
+    run->robots = robots;
+    atomic_init(&run->go, 0);
+    atomic_init(&run->stopped, 0);
+    team_map_init(&run->map, maze->rows, maze->columns);
+    int start_cell = maze->start_row * maze->columns + maze->start_column;
+    atomic_store(&run->map.cells[start_cell], TEAM_CELL_VISITED); // walls unseen
+    atomic_store(&run->map.visit_ms[start_cell], 0);
+    atomic_store(&run->map.cells_visited, 1);
+    if (pthread_barrier_init(&run->barrier, NULL, (unsigned)robots) != 0)
+    {
+        free(run);
+        return false;
+    }
+
+    int started = 0;
+    for (; started < robots; started++)
+    {
+        TeamRobot *member = &run->members[started];
+        member->run = run;
+        member->id = started;
+        member->claim = -1;
+        member->revisits = 0;
+        member->claims_lost = 0;
+        sim_robot_init(&member->sim, maze, config, sim_seed(seed, started));
+        run->next_ms[started] = member->sim.time_ms;
+        if (pthread_create(&member->thread, NULL, team_robot_thread, member) != 0)
+        {
+            break;
+        }
+    }
+    atomic_store(&run->go, started == robots ? 1 : -1);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(run->members[i].thread, NULL);
+    }
+    if (started < robots)
+    {
+        pthread_barrier_destroy(&run->barrier);
+        free(run);
+        return false;
+    }
+
+    result->complete = atomic_load(&run->map.complete);
+    result->time_ms = 0;
+    result->ticks = 0;
+    result->cells_driven = 0;
+    result->revisits = 0;
+    result->claims_lost = 0;
+    for (int i = 0; i < robots; i++)
+    {
+        const TeamRobot *member = &run->members[i];
+        result->time_ms = member->sim.time_ms > result->time_ms ? member->sim.time_ms : result->time_ms;
+        result->ticks = member->sim.ticks > result->ticks ? member->sim.ticks : result->ticks;
+        result->cells_driven += member->sim.cells_driven;
+        result->revisits += member->revisits;
+        result->claims_lost += member->claims_lost;
+    }
+    if (result->complete) // the last cell to be reached first, not whichever robot happened to count it
+    {
+        result->time_ms = 0;
+        for (int c = 0; c < maze->rows * maze->columns; c++)
+        {
+            uint32_t first = atomic_load(&run->map.visit_ms[c]);
+            result->time_ms = first > result->time_ms ? first : result->time_ms;
+        }
+    }
+
+    pthread_barrier_destroy(&run->barrier);
+    free(run);
+    return true;
+}
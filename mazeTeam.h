@@ -0,0 +1,54 @@
+#ifndef MAZE_TEAM
+#define MAZE_TEAM
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mazeSim.h"
+
+#define TEAM_MAX_ROBOTS 8
+#define TEAM_SLOT_MS 100 // robots within this much simulated time of the one furthest behind move together
+
+#define TEAM_CELL_VISITED SIM_CELL_VISITED // shared cell bits, a robot has been in the cell
+#define TEAM_CELL_BLOCKED 0x40             // food or water, robots back out of it so nobody routes through
+
+/*
+ * Map shared by a team of robots exploring the same maze, each robot on its own thread. Nothing is locked:
+ * walls are published as atomic edge bits laid out like SimMaze edges (sim_edge_index()), the wall bit before
+ * the known bit so a reader that sees an edge as known also sees its wall, the latest reading of an edge
+ * replacing the ones before it, visits as atomic cell bits, and
+ * each robot claims the unvisited cell it is heading for with a compare and swap so the others look elsewhere.
+ */
+typedef struct TeamMap
+{
+    int rows;
+    int columns;
+    _Atomic uint8_t known[SIM_MAX_EDGE_BYTES]; // edge has been seen from one of its cells
+    _Atomic uint8_t walls[SIM_MAX_EDGE_BYTES]; // edge was a wall when last read, only meaningful once known
+    _Atomic uint8_t cells[SIM_MAX_CELLS];      // TEAM_CELL_ bits
+    _Atomic uint8_t claims[SIM_MAX_CELLS];     // robot heading for the cell plus one, 0 if nobody is
+    atomic_uint visit_ms[SIM_MAX_CELLS];       // earliest simulated time a robot was in the cell
+    atomic_int cells_visited;
+    atomic_bool complete; // every cell has been visited
+} TeamMap;
+
+/*
+ * Result of a team run
+ */
+typedef struct TeamResult
+{
+    bool complete;
+    uint32_t time_ms; // until every cell had been visited, or the longest any robot ran if they never were
+    int ticks;        // cells each robot drove at most
+    int cells_driven; // by the whole team
+    int revisits;     // cells driven into that some robot had already been in
+    int claims_lost;  // claims another robot got to first
+} TeamResult;
+
+void team_map_init(TeamMap *map, int rows, int columns);
+bool team_publish(TeamMap *map, int row, int column, int walls, bool blocked, uint32_t time_ms);
+int team_choose(TeamMap *map, int robot, int *claim, int row, int column, int direction, int *claims_lost);
+bool team_run(const SimMaze *maze, const SimConfig *config, int robots, uint32_t seed, TeamResult *result);
+
+#endif
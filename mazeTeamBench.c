@@ -0,0 +1,120 @@
+#include "mazeGen.h"
+#include "mazeTeam.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Host program that measures how exploration time scales with the number of robots sharing a map
+ * (mazeTeam.h). Every maze is explored by teams of 1 to TEAM_MAX_ROBOTS robots, all starting in the start cell,
+ * and the simulated time by which every cell had been visited is compared against one robot alone.
+ * usage: mazeTeamBench [-k maze kind] [-s size] [-m mazes] [-n noise] [-S seed]
+ */
+
+typedef struct TeamStats
+{
+    int runs;
+    int completed;
+    double time_ms; // of the completed runs
+    long cells_driven;
+    long revisits;
+    long claims_lost;
+    double wall_ms;
+} TeamStats;
+
+int main(int argc, char **argv)
+{
+    int kind = MAZE_PERFECT;
+    int size = 16;
+    int number_of_mazes = 16;
+    uint32_t seed = 1;
+    SimConfig config = {0, 0, CONTROLLER_PARAMS_DEFAULT};
+
+    int option;
+    while ((option = getopt(argc, argv, "k:s:m:n:S:")) != -1)
+    {
+        switch (option)
+        {
+        case 'k':
+            kind = atoi(optarg);
+            break;
+        case 's':
+            size = atoi(optarg);
+            break;
+        case 'm':
+            number_of_mazes = atoi(optarg);
+            break;
+        case 'n':
+            config.noise = atoi(optarg);
+            break;
+        case 'S':
+            seed = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-k maze kind] [-s size] [-m mazes] [-n noise] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (kind < 0 || kind >= MAZE_KINDS || size < 2 || size > SIM_MAX_SIZE || number_of_mazes < 1)
+    {
+        fprintf(stderr, "kind goes from 0 to %d and size from 2 to %d\n", MAZE_KINDS - 1, SIM_MAX_SIZE);
+        return 1;
+    }
+    config.max_ticks = size * size * 8;
+
+    uint8_t *edges = malloc((size_t)number_of_mazes * SIM_EDGE_BYTES(size, size));
+    SimMaze *mazes = malloc(sizeof(SimMaze) * number_of_mazes);
+    if (edges == NULL || mazes == NULL)
+    {
+        return 1;
+    }
+    for (int m = 0; m < number_of_mazes; m++)
+    {
+        generate_maze(kind, &mazes[m], edges + m * SIM_EDGE_BYTES(size, size), size, size, sim_seed(seed, m));
+    }
+
+    printf("kind %d, %dx%d mazes, noise %d\n", kind, size, size, config.noise);
+    if (config.noise > 5)
+    {
+        printf("above noise 5 the robots read walls that aren't there and cut cells off the map, few runs visit every cell\n");
+    }
+    printf("%6s %8s %9s %8s %10s %12s %9s %11s %8s\n", "robots", "success", "time_s", "speedup", "efficiency", "cells_driven",
+           "revisits", "claims_lost", "wall_ms");
+
+    double alone_s = 0;
+    for (int robots = 1; robots <= TEAM_MAX_ROBOTS; robots++)
+    {
+        TeamStats stats = {0, 0, 0, 0, 0, 0, 0};
+        for (int m = 0; m < number_of_mazes; m++)
+        {
+            TeamResult result;
+            double start = sim_seconds();
+            if (!team_run(&mazes[m], &config, robots, sim_seed(seed + m, 0), &result))
+            {
+                fprintf(stderr, "couldn't start the robot threads\n");
+                return 1;
+            }
+            stats.wall_ms += 1e3 * (sim_seconds() - start);
+            stats.runs++;
+            stats.completed += result.complete;
+            stats.time_ms += result.complete ? result.time_ms : 0;
+            stats.cells_driven += result.cells_driven;
+            stats.revisits += result.revisits;
+            stats.claims_lost += result.claims_lost;
+        }
+
+        double time_s = stats.completed ? stats.time_ms / stats.completed / 1000 : 0;
+        if (robots == 1)
+        {
+            alone_s = time_s;
+        }
+        double speedup = time_s > 0 ? alone_s / time_s : 0;
+        printf("%6d %8.3f %9.1f %8.2f %10.2f %12.1f %9.1f %11.1f %8.2f\n", robots, (double)stats.completed / stats.runs, time_s,
+               speedup, speedup / robots, (double)stats.cells_driven / stats.runs, (double)stats.revisits / stats.runs,
+               (double)stats.claims_lost / stats.runs, stats.wall_ms / stats.runs);
+    }
+
+    free(mazes);
+    free(edges);
+    return 0;
+}
@@ -0,0 +1,412 @@
+#include "mazeCorpus.h"
+#include "mazeGen.h"
+#include "mazeSim.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Host program that searches the controller params with an evolutionary search, running every candidate
+ * over the same set of simulated mazes on all cores. It keeps the params with the lowest mean plus tail
+ * completion time out of those that reach the success floor and writes them out as a params file for
+ * the firmware, see mazeParams.h.
+ * The mazes are generated perfect mazes, or the first ones of a corpus with -c, see mazeCorpus.h.
+ * Nothing is written if no params reach the floor, unless -F forces the best ones out anyway.
+ * usage: mazeTuner [-s size] [-m mazes] [-r robots] [-n noise] [-g generations] [-p population]
+ *                  [-f success floor] [-w tail weight] [-t threads] [-S seed] [-c corpus] [-o file] [-F]
+ */
+
+typedef struct ParamRange
+{
+    const char *name; // macro in mazeParams.h
+    size_t offset;    // field in ControllerParams
+    int low;
+    int high;
+} ParamRange;
+
+static const ParamRange ranges[] = {
+    {"PARAM_MOTOR_SPEED_LEFT", offsetof(ControllerParams, motor_speed_left), 25, 70},
+    {"PARAM_MOTOR_SPEED_RIGHT", offsetof(ControllerParams, motor_speed_right), 25, 70},
+    {"PARAM_WALL_THRESHOLD", offsetof(ControllerParams, wall_threshold), 10, 110},
+    {"PARAM_FACING_WALL_THRESHOLD", offsetof(ControllerParams, facing_wall_threshold), 10, 110},
+    {"PARAM_LIGHT_THRESHOLD", offsetof(ControllerParams, light_threshold), 250, 650},
+    {"PARAM_EXTRA_LINE_DELAY_MS", offsetof(ControllerParams, extra_line_delay_ms), 50, 400},
+    {"PARAM_EXTRA_LINE_RESET_MS", offsetof(ControllerParams, extra_line_reset_ms), 20, 250},
+    {"PARAM_LINE_STOP_MS", offsetof(ControllerParams, line_stop_ms), 200, 800},
+    {"PARAM_PAUSE_MS", offsetof(ControllerParams, pause_ms), 300, 2000},
+    {"PARAM_ADJUST_THRESHOLD", offsetof(ControllerParams, adjust_threshold), 50, 500},
+    {"PARAM_ADJUST_TIMEOUT_MS", offsetof(ControllerParams, adjust_timeout_ms), 0, 1000},
+};
+#define NUMBER_OF_PARAMS (int)(sizeof(ranges) / sizeof(ranges[0]))
+
+typedef struct Candidate
+{
+    ControllerParams params;
+    bool evaluated;
+    bool failed;     // couldn't be run for lack of memory, never picked
+    double success;  // share of the robots that succeeded, see sim_succeeded()
+    double coverage; // average share of the cells visited
+    double mean_ms;  // completion time of the successful robots
+    double p95_ms;
+} Candidate;
+
+typedef struct Tuner
+{
+    SimMaze *mazes;
+    int number_of_mazes;
+    int robots;
+    int noise;
+    double floor;       // success rate a candidate needs before its time counts
+    double tail_weight; // cost is mean + tail_weight * p95
+    uint32_t seed;
+
+    Candidate *candidates;
+    int number_of_candidates;
+    atomic_int next; // next candidate for a worker to take
+} Tuner;
+
+static int *param_field(ControllerParams *params, int index)
+{
+    return (int *)((char *)params + ranges[index].offset);
+}
+
+static int compare_times(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Runs one candidate over every maze, the same noise seeds are used for every candidate
+ */
+static void evaluate(Tuner *tuner, Candidate *candidate)
+{
+    int runs = tuner->number_of_mazes * tuner->robots;
+    uint32_t *times = malloc(sizeof(uint32_t) * runs);
+    int successes = 0;
+    double coverage = 0;
+    double total_ms = 0;
+
+    candidate->evaluated = true;
+    candidate->failed = times == NULL;
+    for (int m = 0; m < tuner->number_of_mazes && !candidate->failed; m++)
+    {
+        const SimMaze *maze = &tuner->mazes[m];
+        SimConfig config = {tuner->noise, maze->rows * maze->columns * 8, candidate->params};
+        SimBatch batch;
+        if (!sim_batch_init(&batch, maze, &config, tuner->robots, sim_seed(tuner->seed, m)))
+        {
+            candidate->failed = true; // not a low success rate, the runs are missing
+            break;
+        }
+        sim_batch_run(&batch);
+
+        for (int i = 0; i < batch.count; i++)
+        {
+            if (sim_succeeded(maze, batch.failed[i], batch.food_found[i], batch.water_found[i], batch.shelter_found[i]))
+            {
+                times[successes++] = batch.time_ms[i];
+                total_ms += batch.time_ms[i];
+            }
+            coverage += (double)batch.cells_visited[i] / (maze->rows * maze->columns);
+        }
+        sim_batch_free(&batch);
+    }
+
+    candidate->success = (double)successes / runs;
+    candidate->coverage = coverage / runs;
+    candidate->mean_ms = successes ? total_ms / successes : 0;
+    candidate->p95_ms = 0;
+    if (successes)
+    {
+        qsort(times, successes, sizeof(uint32_t), compare_times);
+        candidate->p95_ms = times[(successes * 95 - 1) / 100];
+    }
+    free(times);
+}
+
+static void *worker(void *argument)
+{
+    Tuner *tuner = argument;
+    int index;
+    while ((index = atomic_fetch_add(&tuner->next, 1)) < tuner->number_of_candidates)
+    {
+        if (!tuner->candidates[index].evaluated)
+        {
+            evaluate(tuner, &tuner->candidates[index]);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Whether a candidate reached the success floor. One with no successful robots has no time to be ranked by,
+ * so it never counts, whatever the floor.
+ */
+static bool feasible(const Tuner *tuner, const Candidate *candidate)
+{
+    return candidate->success > 0 && candidate->success >= tuner->floor;
+}
+
+/*
+ * Orders candidates best first: the feasible ones by cost, then the rest by success and coverage,
+ * the ones that couldn't be run last
+ */
+static const Tuner *sorting_tuner;
+
+static int compare_candidates(const void *a, const void *b)
+{
+    const Candidate *x = a;
+    const Candidate *y = b;
+    if (x->failed != y->failed)
+    {
+        return x->failed ? 1 : -1;
+    }
+    bool x_feasible = feasible(sorting_tuner, x);
+    bool y_feasible = feasible(sorting_tuner, y);
+    if (x_feasible != y_feasible)
+    {
+        return x_feasible ? -1 : 1;
+    }
+    if (x_feasible)
+    {
+        double x_cost = x->mean_ms + sorting_tuner->tail_weight * x->p95_ms;
+        double y_cost = y->mean_ms + sorting_tuner->tail_weight * y->p95_ms;
+        return (x_cost > y_cost) - (x_cost < y_cost);
+    }
+    if (x->success != y->success)
+    {
+        return x->success < y->success ? 1 : -1;
+    }
+    return (x->coverage < y->coverage) - (x->coverage > y->coverage);
+}
+
+/*
+ * Makes a child of a parent, moving each param with a chance of one in three by up to scale of its range
+ */
+static void mutate(ControllerParams *child, const ControllerParams *parent, double scale, uint32_t *state)
+{
+    *child = *parent;
+    for (int p = 0; p < NUMBER_OF_PARAMS; p++)
+    {
+        if (sim_random(state) % 3 != 0)
+        {
+            continue;
+        }
+        int span = ranges[p].high - ranges[p].low;
+        int step = (int)(span * scale) + 1;
+        int value = *param_field(child, p) + (int)(sim_random(state) % (uint32_t)(2 * step + 1)) - step;
+        value = value < ranges[p].low ? ranges[p].low : value > ranges[p].high ? ranges[p].high : value;
+        *param_field(child, p) = value;
+    }
+}
+
+static void random_params(ControllerParams *params, uint32_t *state)
+{
+    for (int p = 0; p < NUMBER_OF_PARAMS; p++)
+    {
+        *param_field(params, p) = ranges[p].low + (int)(sim_random(state) % (uint32_t)(ranges[p].high - ranges[p].low + 1));
+    }
+}
+
+static bool write_params(const char *path, const Candidate *best)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "/* written by mazeTuner: success %.3f, mean %.0f ms, p95 %.0f ms */\n", best->success,
+            best->mean_ms, best->p95_ms);
+    for (int p = 0; p < NUMBER_OF_PARAMS; p++)
+    {
+        fprintf(file, "#define %s %d\n", ranges[p].name, *param_field((ControllerParams *)&best->params, p));
+    }
+    return fclose(file) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int size = 5;
+    int number_of_mazes = 32;
+    int generations = 20;
+    int population = 32;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *output = "tunedParams.h";
+    const char *corpus_path = NULL;
+    bool force = false;
+    MazeCorpus corpus = {NULL, 0, 0, NULL};
+    Tuner tuner = {NULL, 0, 64, 20, 0.9, 1.0, 1, NULL, 0, 0};
+
+    int option;
+    while ((option = getopt(argc, argv, "s:m:r:n:g:p:f:w:t:S:c:o:F")) != -1)
+    {
+        switch (option)
+        {
+        case 's':
+            size = atoi(optarg);
+            break;
+        case 'm':
+            number_of_mazes = atoi(optarg);
+            break;
+        case 'r':
+            tuner.robots = atoi(optarg);
+            break;
+        case 'n':
+            tuner.noise = atoi(optarg);
+            break;
+        case 'g':
+            generations = atoi(optarg);
+            break;
+        case 'p':
+            population = atoi(optarg);
+            break;
+        case 'f':
+            tuner.floor = atof(optarg);
+            break;
+        case 'w':
+            tuner.tail_weight = atof(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'S':
+            tuner.seed = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            corpus_path = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'F':
+            force = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s size] [-m mazes] [-r robots] [-n noise] [-g generations] [-p population] "
+                            "[-f floor] [-w tail weight] [-t threads] [-S seed] [-c corpus] [-o file] [-F]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (size < 2 || size > SIM_MAX_SIZE || number_of_mazes < 1 || tuner.robots < 1 || population < 4 || threads < 1)
+    {
+        fprintf(stderr, "size goes from 2 to %d, population from 4\n", SIM_MAX_SIZE);
+        return 1;
+    }
+    if (corpus_path != NULL)
+    {
+        if (!corpus_open(&corpus, corpus_path) || corpus.count == 0)
+        {
+            fprintf(stderr, "%s: not a maze corpus\n", corpus_path);
+            return 1;
+        }
+        if ((uint64_t)number_of_mazes > corpus.count)
+        {
+            number_of_mazes = (int)corpus.count;
+        }
+    }
+
+    uint8_t *edges = malloc((size_t)number_of_mazes * SIM_EDGE_BYTES(size, size));
+    tuner.mazes = malloc(sizeof(SimMaze) * number_of_mazes);
+    tuner.candidates = calloc(population, sizeof(Candidate));
+    pthread_t *workers = malloc(sizeof(pthread_t) * threads);
+    if (edges == NULL || tuner.mazes == NULL || tuner.candidates == NULL || workers == NULL)
+    {
+        return 1;
+    }
+    tuner.number_of_mazes = number_of_mazes;
+    tuner.number_of_candidates = population;
+    for (int m = 0; m < number_of_mazes; m++)
+    {
+        if (corpus_path == NULL)
+        {
+            generate_perfect_maze(&tuner.mazes[m], edges + m * SIM_EDGE_BYTES(size, size), size, size, tuner.seed + m);
+        }
+        else if (!corpus_maze(&corpus, (uint64_t)m, &tuner.mazes[m]))
+        {
+            fprintf(stderr, "%s: maze %d is broken\n", corpus_path, m);
+            return 1;
+        }
+    }
+
+    uint32_t state = sim_seed(tuner.seed, -1);
+    ControllerParams hand_picked = CONTROLLER_PARAMS_DEFAULT;
+    tuner.candidates[0].params = hand_picked; // the current params always take part
+    for (int c = 1; c < population; c++)
+    {
+        random_params(&tuner.candidates[c].params, &state);
+    }
+
+    int elites = population / 4;
+    sorting_tuner = &tuner;
+    for (int g = 0; g < generations; g++)
+    {
+        atomic_store(&tuner.next, 0);
+        int started = 0;
+        while (started < threads && pthread_create(&workers[started], NULL, worker, &tuner) == 0)
+        {
+            started++;
+        }
+        for (int t = 0; t < started; t++) // the ones that started take every candidate between them
+        {
+            pthread_join(workers[t], NULL);
+        }
+        if (started == 0)
+        {
+            fprintf(stderr, "couldn't start the worker threads\n");
+            return 1;
+        }
+
+        qsort(tuner.candidates, population, sizeof(Candidate), compare_candidates);
+        const Candidate *best = &tuner.candidates[0];
+        if (best->failed)
+        {
+            fprintf(stderr, "out of memory running the candidates\n");
+            return 1;
+        }
+        printf("generation %d: success %.3f coverage %.3f mean %.0f ms p95 %.0f ms\n", g, best->success,
+               best->coverage, best->mean_ms, best->p95_ms);
+
+        double scale = 0.25 * (generations - g) / generations; // steps shrink as the search settles
+        for (int c = elites; c < population; c++)
+        {
+            const Candidate *parent = &tuner.candidates[sim_random(&state) % (uint32_t)elites];
+            if (c >= population - population / 8)
+            {
+                random_params(&tuner.candidates[c].params, &state); // keep some fresh blood
+            }
+            else
+            {
+                mutate(&tuner.candidates[c].params, &parent->params, scale, &state);
+            }
+            tuner.candidates[c].evaluated = false;
+        }
+    }
+
+    const Candidate *best = &tuner.candidates[0];
+    if (!feasible(&tuner, best) && !force)
+    {
+        fprintf(stderr, "no params reached the success floor of %.2f with a successful robot, %s not written, -F writes the best anyway\n",
+                tuner.floor, output);
+        return 1;
+    }
+    if (!write_params(output, best))
+    {
+        fprintf(stderr, "couldn't write %s\n", output);
+        return 1;
+    }
+    printf("written to %s\n", output);
+
+    free(workers);
+    free(tuner.candidates);
+    free(tuner.mazes);
+    free(edges);
+    corpus_close(&corpus);
+    return 0;
+}